@@ -176,17 +176,17 @@ ST_DATA const int reg_classes[NB_REGS] = {
 #endif
 };
 
-static int func_sub_sp_offset, last_itod_magic;
-static int leaffunc;
+static ST_TLS int func_sub_sp_offset, last_itod_magic;
+static ST_TLS int leaffunc;
 
 #if defined(CONFIG_NOOC_BCHECK)
-static addr_t func_bound_offset;
-static unsigned long func_bound_ind;
+static ST_TLS addr_t func_bound_offset;
+static ST_TLS unsigned long func_bound_ind;
 ST_DATA int func_bound_add_epilog;
 #endif
 
 #if defined(NOOC_ARM_EABI) && defined(NOOC_ARM_VFP)
-static CType float_type, double_type, func_float_type, func_double_type;
+static ST_TLS CType float_type, double_type, func_float_type, func_double_type;
 ST_FUNC void arm_init(struct NOOCState *s)
 {
     float_type.t = VT_FLOAT;
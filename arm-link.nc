@@ -17,6 +17,7 @@
 
 #define PCRELATIVE_DLLPLT 1
 #define RELOCATE_DLLPLT 1
+#define RELOCATE_PARALLEL 0
 
 enum float_abi {
     ARM_SOFTFP_FLOAT,
@@ -45,6 +45,16 @@
 /* define if return values need to be extended explicitely
    at caller side (for interfacing with non-NOOC compilers) */
 #define PROMOTE_RET
+
+#define NOOC_TARGET_JUMP_TABLE
+ST_FUNC void gen_jmp_table(int *tab, int n);
+
+/* arm64_gen_opil() does TOK_UMULH and TOK_SMULH */
+#define NOOC_TARGET_MULH
+
+/* -foptimize-sibling-calls */
+#define NOOC_TARGET_TAIL_CALL
+ST_FUNC int gfunc_tail_call(int nb_args);
 /******************************************************/
 #else /* ! TARGET_DEFS_ONLY */
 /******************************************************/
@@ -93,11 +103,21 @@ ST_DATA const int reg_classes[NB_REGS] = {
 };
 
 #if defined(CONFIG_NOOC_BCHECK)
-static addr_t func_bound_offset;
-static unsigned long func_bound_ind;
+static ST_TLS addr_t func_bound_offset;
+static ST_TLS unsigned long func_bound_ind;
 ST_DATA int func_bound_add_epilog;
 #endif
 
+/* calls in return position, which branch to the end of the function,
+   see gfunc_epilog() */
+#define TAIL_CALLS_MAX 64
+static ST_TLS struct tail_call {
+    int jmp;
+    Sym *sym; /* the function, or NULL for x16 */
+} tail_calls[TAIL_CALLS_MAX];
+static ST_TLS int nb_tail_calls, func_tail;
+static ST_TLS int func_addr_taken; /* the address of a local may be used */
+
 #define IS_FREG(x) ((x) >= TREG_F(0))
 
 static uint32_t intr(int r)
@@ -568,6 +588,7 @@ ST_FUNC void load(int r, SValue *sv)
     }
 
     if (svr == VT_LOCAL) {
+        func_addr_taken = 1;
         if (-svcul < 0x1000)
             o(0xd10003a0 | intr(r) | -svcul << 10); // sub x(r),x29,#...
         else {
@@ -1029,6 +1050,8 @@ ST_FUNC void gfunc_call(int nb_args)
         }
 
     stack = (stack + 15) >> 4 << 4;
+    if (stack)
+        func_tail = 0;
 
     /* fetch cpu flag before generating any code */
     if ((vtop->r & VT_VALMASK) == VT_CMP)
@@ -1132,7 +1155,16 @@ ST_FUNC void gfunc_call(int nb_args)
     }
 
     save_regs(0);
-    arm64_gen_bl_or_b(0);
+    if (func_tail) {
+        struct tail_call *tc = &tail_calls[nb_tail_calls++];
+        tc->sym = NULL;
+        if ((vtop->r & (VT_VALMASK | VT_LVAL)) == VT_CONST && (vtop->r & VT_SYM))
+            tc->sym = vtop->sym;
+        else
+            o(0xaa0003f0 | intr(gv(RC_R30)) << 16); // mov x16,x(r)
+        tc->jmp = gjmp(0);
+    } else
+        arm64_gen_bl_or_b(0);
     --vtop;
     if (stack & 0xfff)
         o(0x910003ff | (stack & 0xfff) << 10); // add sp,sp,#(n)
@@ -1171,10 +1203,24 @@ ST_FUNC void gfunc_call(int nb_args)
     nooc_free(t);
 }
 
-static unsigned long arm64_func_va_list_stack;
-static int arm64_func_va_list_gr_offs;
-static int arm64_func_va_list_vr_offs;
-static int arm64_func_sub_sp_offset;
+/* like gfunc_call() for a call in return position, but branch to the
+   function when the arguments are all passed in registers.  Returns 0
+   if it was called as usual. */
+ST_FUNC int gfunc_tail_call(int nb_args)
+{
+    int done;
+
+    func_tail = nb_tail_calls < TAIL_CALLS_MAX && !nooc_state->do_bounds_check;
+    gfunc_call(nb_args);
+    done = func_tail;
+    func_tail = 0;
+    return done;
+}
+
+static ST_TLS unsigned long arm64_func_va_list_stack;
+static ST_TLS int arm64_func_va_list_gr_offs;
+static ST_TLS int arm64_func_va_list_vr_offs;
+static ST_TLS int arm64_func_sub_sp_offset;
 
 ST_FUNC void gfunc_prolog(Sym *func_sym)
 {
@@ -1282,6 +1328,7 @@ ST_FUNC void gfunc_prolog(Sym *func_sym)
     o(0xd503201f); // nop
     o(0xd503201f); // nop
     loc = 0;
+    nb_tail_calls = func_addr_taken = 0;
 #ifdef CONFIG_NOOC_BCHECK
     if (nooc_state->do_bounds_check)
         gen_bounds_prolog();
@@ -1464,8 +1511,13 @@ ST_FUNC void gfunc_return(CType *func_type)
     vtop--;
 }
 
+/* the calls in return position branch to the end, and are made after
+   the frame is left, unless the callee may see the address of a local */
 ST_FUNC void gfunc_epilog(void)
 {
+    struct tail_call *tc;
+    int epilog, tail = !func_addr_taken;
+
 #ifdef CONFIG_NOOC_BCHECK
     if (nooc_state->do_bounds_check)
         gen_bounds_epilog();
@@ -1500,10 +1552,27 @@ ST_FUNC void gfunc_epilog(void)
             // sub sp,sp,x16,lsl #(j)
         }
     }
+    epilog = ind;
     o(0x910003bf); // mov sp,x29
     o(0xa8ce7bfd); // ldp x29,x30,[sp],#224
 
     o(0xd65f03c0); // ret
+
+    for (tc = tail_calls; tc < tail_calls + nb_tail_calls; tc++) {
+        gsym_addr(tc->jmp, ind);
+        if (tail) {
+            o(0x910003bf); // mov sp,x29
+            o(0xa8ce7bfd); // ldp x29,x30,[sp],#224
+        }
+        if (tc->sym) {
+            greloca(cur_text_section, tc->sym, ind,
+                    tail ? R_AARCH64_JUMP26 : R_AARCH64_CALL26, 0);
+            o(0x14000000 | (uint32_t)!tail << 31); // b/bl
+        } else
+            o(0xd61f0200 | (uint32_t)!tail << 21); // br/blr x16
+        if (!tail)
+            gjmp_addr(epilog);
+    }
 }
 
 ST_FUNC void gen_fill_nops(int bytes)
@@ -1672,6 +1741,26 @@ static int arm64_gen_opic(int op, uint32_t l, int rev, uint64_t val,
         return 1;
     }
 
+    case '*': {
+        uint32_t n = 0;
+        if (val < 3)
+            return 0;
+        if (!((val - 1) & (val - 2))) {
+            while ((uint64_t)2 << n != val - 1)
+                ++n;
+            // add x, a, a, lsl n+1
+            o(0x0b000000 | l << 31 | x | a << 5 | a << 16 | (n + 1) << 10);
+        } else if (!((val + 1) & val) && val < (uint64_t)1 << (31 + l)) {
+            while ((uint64_t)2 << n != val + 1)
+                ++n;
+            // sub x30, a, a, lsl n+1; neg x, x30
+            o(0x4b00001e | l << 31 | a << 5 | a << 16 | (n + 1) << 10);
+            o(0x4b1e03e0 | l << 31 | x);
+        } else
+            return 0;
+        return 1;
+    }
+
     case TOK_SAR:
     case TOK_SHL:
     case TOK_SHR: {
@@ -1818,6 +1907,22 @@ static void arm64_gen_opil(int op, uint32_t l)
         o(0x6b00001f | l << 31 | a << 5 | b << 16); // cmp
         o(0x1a9f87e0 | x); // cset wA,ls
         break;
+    case TOK_UMULH:
+        if (l)
+            o(0x9bc07c00 | x | a << 5 | b << 16); // umulh
+        else {
+            o(0x9ba07c00 | x | a << 5 | b << 16); // umull
+            o(0xd360fc00 | x | x << 5); // lsr x, x, #32
+        }
+        break;
+    case TOK_SMULH:
+        if (l)
+            o(0x9b407c00 | x | a << 5 | b << 16); // smulh
+        else {
+            o(0x9b207c00 | x | a << 5 | b << 16); // smull
+            o(0x9360fc00 | x | x << 5); // asr x, x, #32
+        }
+        break;
     case TOK_UMOD:
         // Use x30 for quotient:
         o(0x1ac00800 | l << 31 | 30 | a << 5 | b << 16); // udiv
@@ -2076,6 +2181,23 @@ ST_FUNC void ggoto(void)
     --vtop;
 }
 
+// Jump to tab[vtop], 0 <= vtop < n. tab[] holds code addresses, or -1
+// for the code after the table, which follows the jump as offsets from
+// its start.
+ST_FUNC void gen_jmp_table(int *tab, int n)
+{
+    uint32_t r = intr(gv(RC_INT));
+    int t, i;
+    --vtop;
+    o(0x10000000 | 4 << 5 | 30); // adr x30,.+16
+    o(0xb8a05800 | r << 16 | 30 << 5 | r); // ldrsw x(r),[x30,w(r),uxtw #2]
+    o(0x8b000000 | r << 16 | 30 << 5 | r); // add x(r),x30,x(r)
+    o(0xd61f0000 | r << 5); // br x(r)
+    t = ind;
+    for (i = 0; i < n; i++)
+        o((tab[i] < 0 ? t + 4 * n : tab[i]) - t);
+}
+
 ST_FUNC void gen_clear_cache(void)
 {
     uint32_t beg, end, dsz, isz, p, lab1, b1;
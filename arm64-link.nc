@@ -16,6 +16,7 @@
 
 #define PCRELATIVE_DLLPLT 1
 #define RELOCATE_DLLPLT 1
+#define RELOCATE_PARALLEL 0
 
 #else /* !TARGET_DEFS_ONLY */
 
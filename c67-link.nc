@@ -17,6 +17,7 @@
 
 #define PCRELATIVE_DLLPLT 0
 #define RELOCATE_DLLPLT 0
+#define RELOCATE_PARALLEL 0
 
 #else /* !TARGET_DEFS_ONLY */
 
@@ -65,9 +65,11 @@
 /********************************************************/
 /* global variables */
 
-/* XXX: get rid of this ASAP (or maybe not) */
+/* the state in use by the current thread (see CONFIG_NOOC_TLS) */
 ST_DATA struct NOOCState *nooc_state;
+#if !CONFIG_NOOC_TLS
 NOOC_SEM(static nooc_compile_sem);
+#endif
 /* an array of pointers to memory to be free'd after errors */
 ST_DATA void** stk_data;
 ST_DATA int nb_stk_data;
@@ -133,6 +135,11 @@ ST_FUNC void post_sem(NOOCSem *p)
 {
     LeaveCriticalSection(&p->cr);
 }
+ST_FUNC void delete_sem(NOOCSem *p)
+{
+    if (p->init)
+        DeleteCriticalSection(&p->cr), p->init = 0;
+}
 #elif defined __APPLE__
 /* Half-compatible MacOS doesn't have non-shared (process local)
    semaphores.  Use the dispatch framework for lightweight locks.  */
@@ -146,6 +153,11 @@ ST_FUNC void post_sem(NOOCSem *p)
 {
     dispatch_semaphore_signal(p->sem);
 }
+ST_FUNC void delete_sem(NOOCSem *p)
+{
+    if (p->init)
+        dispatch_release(p->sem), p->init = 0;
+}
 #else
 ST_FUNC void wait_sem(NOOCSem *p)
 {
@@ -157,14 +169,107 @@ ST_FUNC void post_sem(NOOCSem *p)
 {
     sem_post(&p->sem);
 }
+ST_FUNC void delete_sem(NOOCSem *p)
+{
+    if (p->init)
+        sem_destroy(&p->sem), p->init = 0;
+}
 #endif
 #endif
 
+/********************************************************/
+/* a minimal thread pool: call fn(arg, i) for i = 0 ... n - 1 from up
+   to s1->nb_jobs threads, the calling thread included.  Tasks are taken
+   in order but may finish in any order.  The lock is per call, and
+   error1() takes it while s1->tasks is set, so that other states in
+   other threads are not serialized with this one. */
+#if CONFIG_NOOC_SEMLOCK
+typedef struct NOOCTasks {
+    void (*fn)(void *arg, int i);
+    void *arg;
+    int next, n;
+    NOOC_SEM(sem);
+} NOOCTasks;
+
+#ifdef _WIN32
+static DWORD WINAPI nooc_tasks_thread(void *p)
+#else
+static void *nooc_tasks_thread(void *p)
+#endif
+{
+    NOOCTasks *t = p;
+    int i;
+
+    for (;;) {
+        WAIT_SEM(&t->sem);
+        i = t->next++;
+        POST_SEM(&t->sem);
+        if (i >= t->n)
+            return 0;
+        t->fn(t->arg, i);
+    }
+}
+#endif
+
+ST_FUNC void nooc_run_tasks(NOOCState *s1, int n, void (*fn)(void *arg, int i), void *arg)
+{
+    int i;
+#if CONFIG_NOOC_SEMLOCK
+    int nb_threads = s1->nb_jobs;
+# define MAX_TASK_THREADS 64
+# ifdef _WIN32
+    HANDLE th[MAX_TASK_THREADS];
+# else
+    pthread_t th[MAX_TASK_THREADS];
+# endif
+    NOOCTasks t;
+    int nb;
+
+    if (nb_threads > n)
+        nb_threads = n;
+    if (nb_threads > MAX_TASK_THREADS)
+        nb_threads = MAX_TASK_THREADS;
+    if (nb_threads > 1) {
+        memset(&t, 0, sizeof t);
+        t.fn = fn, t.arg = arg, t.n = n;
+        /* wait_sem() initializes lazily: do that before threads race */
+        WAIT_SEM(&t.sem), POST_SEM(&t.sem);
+        s1->tasks = &t;
+        for (nb = 0; nb < nb_threads - 1; ++nb) {
+# ifdef _WIN32
+            th[nb] = CreateThread(NULL, 0, nooc_tasks_thread, &t, 0, NULL);
+            if (!th[nb])
+                break;
+# else
+            if (pthread_create(&th[nb], NULL, nooc_tasks_thread, &t))
+                break;
+# endif
+        }
+        nooc_tasks_thread(&t);
+        for (i = 0; i < nb; ++i) {
+# ifdef _WIN32
+            WaitForSingleObject(th[i], INFINITE);
+            CloseHandle(th[i]);
+# else
+            pthread_join(th[i], NULL);
+# endif
+        }
+        s1->tasks = NULL;
+        DELETE_SEM(&t.sem);
+        return;
+    }
+#endif
+    for (i = 0; i < n; ++i)
+        fn(arg, i);
+}
+
 PUB_FUNC void nooc_enter_state(NOOCState *s1)
 {
     if (s1->error_set_jmp_enabled)
         return;
+#if !CONFIG_NOOC_TLS
     WAIT_SEM(&nooc_compile_sem);
+#endif
     nooc_state = s1;
 }
 
@@ -173,7 +278,9 @@ PUB_FUNC void nooc_exit_state(NOOCState *s1)
     if (s1->error_set_jmp_enabled)
         return;
     nooc_state = NULL;
+#if !CONFIG_NOOC_TLS
     POST_SEM(&nooc_compile_sem);
+#endif
 }
 
 /********************************************************/
@@ -494,6 +601,225 @@ ST_FUNC int normalized_PATHCMP(const char *f1, const char *f2)
     return ret;
 }
 
+/* absolute name of the existing file 'f' (for .nch dependencies),
+   otherwise a copy of 'f' */
+ST_FUNC char *nooc_abspath(const char *f)
+{
+    char *p, *q;
+    if (!(p = realpath(f, NULL)))
+        return nooc_strdup(f);
+    q = nooc_strdup(p);
+    free(p); /* using original free */
+    return q;
+}
+
+/* Listings of the include directories, so that looking for a header
+   in the -I and system paths where it isn't costs no open() syscall.
+   They are shared by all states of the process (-j, -c with several
+   files, libnooc users) and revalidated against the directory mtime
+   once per state.  Uses the original malloc: the cache outlives each
+   state, and is freed with the last one. */
+typedef struct IncDir {
+    struct IncDir *next;
+    unsigned checked; /* incdir_id of the state that last stat'ed it */
+    int listed; /* 1: names valid, 0: no such dir, -1: unreadable */
+    time_t mtime;
+    unsigned mask; /* size of 'hash' - 1 */
+    unsigned *hash; /* offset + 1 into 'names' */
+    char *names;
+    char path[1];
+} IncDir;
+
+#define INCDIR_HASH_SIZE 64
+NOOC_SEM(static incdir_sem);
+static IncDir *incdir_hash[INCDIR_HASH_SIZE];
+static unsigned incdir_gen;
+static int incdir_users; /* live states */
+
+#if defined _WIN32 || defined __APPLE__
+# define incdir_fold(c) toup(c) /* case insensitive file systems */
+#else
+# define incdir_fold(c) (c)
+#endif
+
+static unsigned incdir_hash_str(const char *s, int len)
+{
+    unsigned h = 2166136261u;
+    while (len--)
+        h = (h ^ incdir_fold((unsigned char)*s++)) * 16777619;
+    return h;
+}
+
+static int incdir_cmp(const char *s, const char *name, int len)
+{
+    while (len--)
+        if (incdir_fold((unsigned char)*s++) != incdir_fold((unsigned char)*name++))
+            return 1;
+    return *s;
+}
+
+/* "dir", "dir/", "./dir" and "dir//." give the same key "dir/", and
+   the current directory gives "" */
+static void incdir_key(char *buf, int size, const char *dir)
+{
+    char *q = buf, *e = buf + size - 2;
+    const char *p = dir;
+
+    while (IS_DIRSEP(*p) && q < e)
+        *q++ = *p++; /* root, or '//' on Windows */
+    while (*p && q < e) {
+        if (IS_DIRSEP(*p)) {
+            ++p;
+        } else if (p[0] == '.' && (!p[1] || IS_DIRSEP(p[1]))) {
+            ++p;
+        } else {
+            while (*p && !IS_DIRSEP(*p) && q < e)
+                *q++ = *p++;
+            *q++ = '/';
+        }
+    }
+    *q = 0;
+}
+
+/* read the directory into d->names ("a\0b\0...\0") and d->hash */
+static int incdir_read(IncDir *d)
+{
+    char *names = NULL, *p;
+    unsigned *hash = NULL, size, n = 0, len = 0, alloc = 0, h, i;
+    const char *fn;
+#ifdef _WIN32
+    WIN32_FIND_DATAA fd;
+    HANDLE dh;
+    char pat[1024];
+    snprintf(pat, sizeof pat, "%s*", d->path);
+    dh = FindFirstFileA(pat, &fd);
+    if (dh == INVALID_HANDLE_VALUE)
+        return -1;
+    do {
+        fn = fd.cFileName;
+#else
+    DIR *dh;
+    struct dirent *de;
+    dh = opendir(d->path[0] ? d->path : ".");
+    if (!dh)
+        return -1;
+    while (!!(de = readdir(dh))) {
+        fn = de->d_name;
+#endif
+        i = strlen(fn) + 1;
+        if (len + i > alloc) {
+            alloc = (len + i) * 2 + 256;
+            p = realloc(names, alloc);
+            if (!p) {
+                n = -1;
+                break;
+            }
+            names = p;
+        }
+        memcpy(names + len, fn, i);
+        len += i, ++n;
+#ifdef _WIN32
+    } while (FindNextFileA(dh, &fd));
+    FindClose(dh);
+#else
+    }
+    closedir(dh);
+#endif
+    if (n != (unsigned)-1) {
+        for (size = 16; size < n * 2; size *= 2)
+            ;
+        hash = calloc(size, sizeof *hash);
+    }
+    if (!hash) {
+        free(hash), free(names);
+        return -1;
+    }
+    for (p = names; p < names + len; p += strlen(p) + 1) {
+        h = incdir_hash_str(p, strlen(p));
+        while (hash[h & (size - 1)])
+            ++h;
+        hash[h & (size - 1)] = p - names + 1;
+    }
+    free(d->hash), free(d->names);
+    d->hash = hash, d->names = names, d->mask = size - 1;
+    return 1;
+}
+
+/* return 0 if 'name' from an #include certainly does not exist in 'dir'
+   (which ends with a slash), 1 if it might */
+ST_FUNC int nooc_incdir_has(NOOCState *s1, const char *dir0, const char *name)
+{
+    IncDir *d, **pd;
+    struct stat st;
+    unsigned h;
+    int len, ret = 1;
+    char dir[1024];
+
+    for (len = 0; name[len] && !IS_DIRSEP(name[len]); ++len)
+        ;
+    incdir_key(dir, sizeof dir, dir0);
+    h = incdir_hash_str(dir, strlen(dir)) & (INCDIR_HASH_SIZE - 1);
+    WAIT_SEM(&incdir_sem);
+    if (!s1->incdir_id)
+        s1->incdir_id = ++incdir_gen;
+    for (pd = &incdir_hash[h]; !!(d = *pd); pd = &d->next)
+        if (0 == strcmp(d->path, dir))
+            break;
+    if (!d) {
+        d = calloc(1, sizeof *d + strlen(dir));
+        if (!d)
+            goto done;
+        strcpy(d->path, dir);
+        *pd = d;
+    }
+    if (d->checked != s1->incdir_id) {
+        d->checked = s1->incdir_id;
+        if (stat(dir[0] ? dir : ".", &st) || (st.st_mode & S_IFMT) != S_IFDIR) {
+            d->listed = 0;
+        } else if (d->listed != 1 || st.st_mtime != d->mtime) {
+            d->listed = incdir_read(d);
+            s1->incdir_reads++;
+            /* a directory modified in the last second may change again
+               without a new mtime: list it again next time */
+            d->mtime = st.st_mtime >= time(NULL) - 1 ? (time_t)-1 : st.st_mtime;
+        }
+    }
+    if (d->listed == 0) {
+        ret = 0;
+    } else if (d->listed == 1 && len) {
+        h = incdir_hash_str(name, len);
+        for (ret = 0; d->hash[h & d->mask]; ++h)
+            if (0 == incdir_cmp(d->names + d->hash[h & d->mask] - 1, name, len)) {
+                ret = 1;
+                break;
+            }
+    }
+    if (!ret && len)
+        s1->incdir_skips++;
+done:
+    POST_SEM(&incdir_sem);
+    return ret;
+}
+
+/* from nooc_new() (n = 1) and nooc_delete() (n = -1): free the
+   listings with the last state */
+static void incdir_users_add(int n)
+{
+    IncDir *d;
+    int i;
+
+    WAIT_SEM(&incdir_sem);
+    incdir_users += n;
+    if (0 == incdir_users) {
+        for (i = 0; i < INCDIR_HASH_SIZE; ++i)
+            while (!!(d = incdir_hash[i])) {
+                incdir_hash[i] = d->next;
+                free(d->hash), free(d->names), free(d);
+            }
+    }
+    POST_SEM(&incdir_sem);
+}
+
 #define free(p) use_nooc_free(p)
 #define malloc(s) use_nooc_malloc(s)
 #define realloc(p, s) use_nooc_realloc(p, s)
@@ -625,6 +951,8 @@ static void error1(int mode, const char *fmt, va_list ap)
         cstr_printf(&cs, "nooc: ");
     cstr_printf(&cs, mode == ERROR_WARN ? "warning: " : "error: ");
     cstr_vprintf(&cs, fmt, ap);
+    if (s1->tasks)
+        WAIT_SEM(&s1->tasks->sem);
     if (!s1 || !s1->error_func) {
         /* default case: stderr */
         if (s1 && s1->output_type == NOOC_OUTPUT_PREPROCESS && s1->ppfp == stdout)
@@ -638,9 +966,12 @@ static void error1(int mode, const char *fmt, va_list ap)
     cstr_free(&cs);
     if (mode != ERROR_WARN)
         s1->nb_errors++;
+    if (s1->tasks)
+        POST_SEM(&s1->tasks->sem);
     if (mode == ERROR_ERROR && s1->error_set_jmp_enabled) {
         while (nb_stk_data)
             nooc_free(*(void**)stk_data[--nb_stk_data]);
+        noocelf_end_input(s1);
         longjmp(s1->error_jmp_buf, 1);
     }
 }
@@ -719,10 +1050,14 @@ ST_FUNC void nooc_close(void)
 {
     NOOCState *s1 = nooc_state;
     BufferedFile *bf = file;
-    if (bf->fd > 0) {
-        close(bf->fd);
+    if (bf->fd > 0 || bf->map)
         total_lines += bf->line_num - 1;
-    }
+    if (bf->fd > 0)
+        close(bf->fd);
+#if CONFIG_NOOC_MMAP
+    if (bf->map)
+        munmap(bf->map, bf->map_size);
+#endif
     if (bf->true_filename != bf->filename)
         nooc_free(bf->true_filename);
     file = bf->prev;
@@ -742,13 +1077,57 @@ static int _nooc_open(NOOCState *s1, const char *filename)
     return fd;
 }
 
+/* open a buffered file reading from 'fd'.  Large regular files are
+   mapped at once, with a page before the data for chars that the lexer
+   ungets and room for the CH_EOB mark after it.  Others (and pipes or
+   stdin) are read in IO_BUF_SIZE blocks by handle_eob(). */
+static void nooc_open_fd(NOOCState *s1, const char *filename, int fd)
+{
+    struct stat st;
+    int known = fd > 0 && 0 == fstat(fd, &st);
+#if CONFIG_NOOC_MMAP
+    size_t pg, len;
+    uint8_t *p;
+
+    if (known && S_ISREG(st.st_mode)
+        && st.st_size > IO_BUF_SIZE && st.st_size < 0x7fffffff) {
+        pg = sysconf(_SC_PAGESIZE);
+        len = pg + (st.st_size + pg) / pg * pg;
+        p = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            if (mmap(p + pg, st.st_size, PROT_READ|PROT_WRITE,
+                     MAP_PRIVATE|MAP_FIXED, fd, 0) != MAP_FAILED) {
+                close(fd);
+                nooc_open_bf(s1, filename, 1);
+                file->map = p;
+                file->map_size = len;
+                file->buf_ptr = p + pg;
+                file->buf_end = p + pg + st.st_size;
+                *file->buf_end = CH_EOB;
+                total_bytes += st.st_size;
+                total_mapped += st.st_size;
+                goto done;
+            }
+            munmap(p, len);
+        }
+    }
+#endif
+    nooc_open_bf(s1, filename, 0);
+    file->fd = fd;
+#if CONFIG_NOOC_MMAP
+done:
+#endif
+    /* for include guards, see parse_include() */
+    if (known)
+        file->dev = st.st_dev, file->ino = st.st_ino;
+}
+
 ST_FUNC int nooc_open(NOOCState *s1, const char *filename)
 {
     int fd = _nooc_open(s1, filename);
     if (fd < 0)
         return -1;
-    nooc_open_bf(s1, filename, 0);
-    file->fd = fd;
+    nooc_open_fd(s1, filename, fd);
     return 0;
 }
 
@@ -757,10 +1136,8 @@ static int nooc_compile(NOOCState *s1, int filetype, const char *str, int fd)
 {
     /* Here we enter the code section where we use the global variables for
        parsing and code generation (noocpp.c, noocgen.c, <target>-gen.c).
-       Other threads need to wait until we're done.
-
-       Alternatively we could use thread local storage for those global
-       variables, which may or may not have advantages */
+       With CONFIG_NOOC_TLS those are per thread, otherwise other threads
+       need to wait until we're done. */
 
     nooc_enter_state(s1);
     s1->error_set_jmp_enabled = 1;
@@ -773,8 +1150,7 @@ static int nooc_compile(NOOCState *s1, int filetype, const char *str, int fd)
             nooc_open_bf(s1, "<string>", len);
             memcpy(file->buffer, str, len);
         } else {
-            nooc_open_bf(s1, str, 0);
-            file->fd = fd;
+            nooc_open_fd(s1, str, fd);
         }
 
         preprocess_start(s1, filetype);
@@ -782,6 +1158,8 @@ static int nooc_compile(NOOCState *s1, int filetype, const char *str, int fd)
 
         if (s1->output_type == NOOC_OUTPUT_PREPROCESS) {
             nooc_preprocess(s1);
+        } else if (s1->gen_pch) {
+            nooc_pch_create(s1);
         } else {
             noocelf_begin_file(s1);
             if (filetype & (AFF_TYPE_ASM | AFF_TYPE_ASMPP)) {
@@ -832,6 +1210,7 @@ LIBNOOCAPI NOOCState *nooc_new(void)
 #ifdef MEM_DEBUG
     nooc_memcheck(1);
 #endif
+    incdir_users_add(1);
 
 #undef gnu_ext
 
@@ -880,6 +1259,7 @@ LIBNOOCAPI void nooc_delete(NOOCState *s1)
     /* free include paths */
     dynarray_reset(&s1->include_paths, &s1->nb_include_paths);
     dynarray_reset(&s1->sysinclude_paths, &s1->nb_sysinclude_paths);
+    incdir_users_add(-1);
 
     nooc_free(s1->nooc_lib_path);
     nooc_free(s1->soname);
@@ -900,6 +1280,7 @@ LIBNOOCAPI void nooc_delete(NOOCState *s1)
     cstr_free(&s1->cmdline_defs);
     cstr_free(&s1->cmdline_incl);
     cstr_free(&s1->linker_arg);
+    cstr_free(&s1->pch_data);
 #ifdef NOOC_IS_NATIVE
     /* free runtime memory */
     nooc_run_free(s1);
@@ -1025,6 +1406,28 @@ LIBNOOCAPI int nooc_add_sysinclude_path(NOOCState *s, const char *pathname)
     return 0;
 }
 
+/* -j: list the include directories before forking, so that the compile
+   processes inherit the listings instead of each reading them again */
+PUB_FUNC void nooc_incdir_fill(NOOCState *s)
+{
+    char **dirs = NULL, buf[1024];
+    int nb_dirs = 0, i;
+    unsigned reads = s->incdir_reads;
+
+    for (i = 0; i < s->nb_include_paths; ++i)
+        dynarray_add(&dirs, &nb_dirs, nooc_strdup(s->include_paths[i]));
+    for (i = 0; i < s->nb_sysinclude_paths; ++i)
+        dynarray_add(&dirs, &nb_dirs, nooc_strdup(s->sysinclude_paths[i]));
+    if (!s->nostdinc) /* added by nooc_set_output_type() */
+        nooc_split_path(s, &dirs, &nb_dirs, CONFIG_NOOC_SYSINCLUDEPATHS);
+    for (i = 0; i < nb_dirs; ++i) {
+        snprintf(buf, sizeof buf, "%s/", dirs[i]);
+        nooc_incdir_has(s, buf, "");
+    }
+    dynarray_reset(&dirs, &nb_dirs);
+    s->incdir_reads = reads; /* -bench: the children count their own */
+}
+
 /* add/update a 'DLLReference', Just find if level == -1  */
 ST_FUNC DLLReference *nooc_add_dllref(NOOCState *s1, const char *dllname, int level)
 {
@@ -1195,11 +1598,10 @@ check_success:
     return ret;
 }
 
-LIBNOOCAPI int nooc_add_file(NOOCState *s, const char *filename)
+/* use a file extension to detect a filetype if none was specified */
+PUB_FUNC int nooc_filetype(int filetype, const char *filename)
 {
-    int filetype = s->filetype;
     if (0 == (filetype & AFF_TYPE_MASK)) {
-        /* use a file extension to detect a filetype */
         const char *ext = nooc_fileextension(filename);
         if (ext[0]) {
             ext++;
@@ -1217,6 +1619,12 @@ LIBNOOCAPI int nooc_add_file(NOOCState *s, const char *filename)
             filetype = AFF_TYPE_C;
         }
     }
+    return filetype;
+}
+
+LIBNOOCAPI int nooc_add_file(NOOCState *s, const char *filename)
+{
+    int filetype = nooc_filetype(s->filetype, filename);
     return nooc_add_file_internal(s, filename, filetype | AFF_PRINT_ERROR);
 }
 
@@ -1543,6 +1951,21 @@ static int nooc_set_linker(NOOCState *s, const char *option)
                 s->filetype |= AFF_WHOLE_ARCHIVE;
             else
                 s->filetype &= ~AFF_WHOLE_ARCHIVE;
+        } else if (ret = link_option(option, "?gc-sections", &p), ret) {
+            s->gc_sections = ret > 0;
+        } else if (ret = link_option(option, "?print-gc-sections", &p), ret) {
+            s->print_gc_sections = ret > 0;
+        } else if (link_option(option, "icf=", &p)) {
+            if (!strcmp(p, "all"))
+                s->icf = 2;
+            else if (!strcmp(p, "safe"))
+                s->icf = 1;
+            else if (!strcmp(p, "none"))
+                s->icf = 0;
+            else
+                goto err;
+        } else if (ret = link_option(option, "?print-icf-sections", &p), ret) {
+            s->print_icf_sections = ret > 0;
         } else if (link_option(option, "z=", &p)) {
             ignoring = 1;
         } else if (p) {
@@ -1583,6 +2006,7 @@ enum {
     NOOC_OPTION_g,
     NOOC_OPTION_c,
     NOOC_OPTION_dumpversion,
+    NOOC_OPTION_digest,
     NOOC_OPTION_d,
     NOOC_OPTION_static,
     NOOC_OPTION_std,
@@ -1599,11 +2023,13 @@ enum {
     NOOC_OPTION_f,
     NOOC_OPTION_isystem,
     NOOC_OPTION_iwithprefix,
+    NOOC_OPTION_j,
     NOOC_OPTION_include,
     NOOC_OPTION_nostdinc,
     NOOC_OPTION_nostdlib,
     NOOC_OPTION_print_search_dirs,
     NOOC_OPTION_rdynamic,
+    NOOC_OPTION_pch,
     NOOC_OPTION_pthread,
     NOOC_OPTION_run,
     NOOC_OPTION_w,
@@ -1659,12 +2085,14 @@ static const NOOCOption nooc_options[] = {
     { "dynamiclib", NOOC_OPTION_dynamiclib, 0 },
 #endif
     { "dumpversion", NOOC_OPTION_dumpversion, 0},
+    { "digest", NOOC_OPTION_digest, 0},
     { "d", NOOC_OPTION_d, NOOC_OPTION_HAS_ARG | NOOC_OPTION_NOSEP },
     { "static", NOOC_OPTION_static, 0 },
     { "std", NOOC_OPTION_std, NOOC_OPTION_HAS_ARG | NOOC_OPTION_NOSEP },
     { "shared", NOOC_OPTION_shared, 0 },
     { "soname", NOOC_OPTION_soname, NOOC_OPTION_HAS_ARG },
     { "o", NOOC_OPTION_o, NOOC_OPTION_HAS_ARG },
+    { "pch", NOOC_OPTION_pch, 0 },
     { "pthread", NOOC_OPTION_pthread, 0},
     { "run", NOOC_OPTION_run, NOOC_OPTION_HAS_ARG | NOOC_OPTION_NOSEP },
     { "rdynamic", NOOC_OPTION_rdynamic, 0 },
@@ -1682,6 +2110,7 @@ static const NOOCOption nooc_options[] = {
 #endif
     { "f", NOOC_OPTION_f, NOOC_OPTION_HAS_ARG | NOOC_OPTION_NOSEP },
     { "isystem", NOOC_OPTION_isystem, NOOC_OPTION_HAS_ARG },
+    { "j", NOOC_OPTION_j, NOOC_OPTION_HAS_ARG },
     { "include", NOOC_OPTION_include, NOOC_OPTION_HAS_ARG },
     { "nostdinc", NOOC_OPTION_nostdinc, 0 },
     { "nostdlib", NOOC_OPTION_nostdlib, 0 },
@@ -1741,6 +2170,12 @@ static const FlagDef options_f[] = {
     { offsetof(NOOCState, ms_extensions), 0, "ms-extensions" },
     { offsetof(NOOCState, dollars_in_identifiers), 0, "dollars-in-identifiers" },
     { offsetof(NOOCState, test_coverage), 0, "test-coverage" },
+    { offsetof(NOOCState, no_peephole), FD_INVERT, "peephole" },
+    { offsetof(NOOCState, inline_functions), 0, "inline-functions" },
+    { offsetof(NOOCState, tail_calls), 0, "optimize-sibling-calls" },
+    { offsetof(NOOCState, vectorize), 0, "tree-vectorize" },
+    { offsetof(NOOCState, function_sections), 0, "function-sections" },
+    { offsetof(NOOCState, data_sections), 0, "data-sections" },
     { 0, 0, NULL }
 };
 
@@ -1748,6 +2183,8 @@ static const FlagDef options_m[] = {
     { offsetof(NOOCState, ms_bitfields), 0, "ms-bitfields" },
 #ifdef NOOC_TARGET_X86_64
     { offsetof(NOOCState, nosse), FD_INVERT, "sse" },
+    { offsetof(NOOCState, avx), 0, "avx" },
+    { offsetof(NOOCState, avx2), 0, "avx2" },
 #endif
     { 0, 0, NULL }
 };
@@ -1957,6 +2394,10 @@ dorun:
             args_parser_add_file(s, optarg, AFF_TYPE_LIB | (s->filetype & ~AFF_TYPE_MASK));
             s->nb_libraries++;
             break;
+        case NOOC_OPTION_pch:
+            s->gen_pch = 1;
+            x = NOOC_OUTPUT_OBJ;
+            goto set_output_type;
         case NOOC_OPTION_pthread:
             s->option_pthread = 1;
             break;
@@ -2040,6 +2481,9 @@ dorun:
         case NOOC_OPTION_isystem:
             nooc_add_sysinclude_path(s, optarg);
             break;
+        case NOOC_OPTION_j:
+            s->nb_jobs = atoi(optarg);
+            break;
         case NOOC_OPTION_include:
             cstr_printf(&s->cmdline_incl, "#include \"%s\"\n", optarg);
             break;
@@ -2109,7 +2553,12 @@ dorun:
         case NOOC_OPTION_Wp:
             r = optarg;
             goto reparse;
+        case NOOC_OPTION_digest:
+            s->pp_digest = 1;
+            /* fall through */
         case NOOC_OPTION_E:
+            if (s->output_type == NOOC_OUTPUT_PREPROCESS)
+                break;
             x = NOOC_OUTPUT_PREPROCESS;
             goto set_output_type;
         case NOOC_OPTION_P:
@@ -2225,9 +2674,9 @@ PUB_FUNC void nooc_print_stats(NOOCState *s1, unsigned total_time)
 {
     if (!total_time)
         total_time = 1;
-    fprintf(stderr, "# %d idents, %d lines, %u bytes\n"
+    fprintf(stderr, "# %d idents, %d lines, %u bytes (%u mapped)\n"
                     "# %0.3f s, %u lines/s, %0.1f MB/s\n",
-           total_idents, total_lines, total_bytes,
+           total_idents, total_lines, total_bytes, total_mapped,
            (double)total_time/1000,
            (unsigned)total_lines*1000/total_time,
            (double)total_bytes/1000/total_time);
@@ -2237,6 +2686,23 @@ PUB_FUNC void nooc_print_stats(NOOCState *s1, unsigned total_time)
            s1->total_output[2],
            s1->total_output[3]
            );
+    fprintf(stderr, "# include guards: %u hits, %u misses\n",
+           s1->include_hits, s1->include_misses);
+    fprintf(stderr, "# include dirs: %u listed, %u open() saved\n",
+           s1->incdir_reads, s1->incdir_skips);
+#ifndef _WIN32
+    {
+        struct rusage ru;
+        if (0 == getrusage(RUSAGE_SELF, &ru))
+            fprintf(stderr, "# %ld KB peak memory (RSS)\n",
+# ifdef __APPLE__
+                    (long)ru.ru_maxrss / 1024
+# else
+                    (long)ru.ru_maxrss
+# endif
+                    );
+    }
+#endif
 #ifdef MEM_DEBUG
     fprintf(stderr, "# %d bytes memory used\n", mem_max_size);
 #endif
@@ -36,12 +36,20 @@
 #include <errno.h>
 #include <math.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <setjmp.h>
 #include <time.h>
 
+#if defined __SSE2__ && defined __GNUC__ && !defined __TINYC__
+# include <emmintrin.h>
+# define NOOC_SCAN_SSE2 1 /* used by the lexer, see scan_chars() */
+#endif
+
 #ifndef _WIN32
 # include <unistd.h>
 # include <sys/time.h>
+# include <sys/resource.h>
+# include <dirent.h>
 # ifndef CONFIG_NOOC_STATIC
 #  include <dlfcn.h>
 # endif
@@ -215,6 +223,20 @@ extern long double strtold (const char *__nptr, char **__endptr);
 #  define CONFIG_NEW_MACHO 1 /* enable new macho code */
 #endif
 
+#ifndef CONFIG_NOOC_MMAP
+# ifdef _WIN32
+#  define CONFIG_NOOC_MMAP 0
+# else
+#  define CONFIG_NOOC_MMAP 1 /* map large source files instead of read() */
+# endif
+#endif
+#if CONFIG_NOOC_MMAP
+# include <sys/mman.h>
+# if !defined MAP_ANONYMOUS && defined MAP_ANON
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+#endif
+
 #if defined TARGETOS_OpenBSD \
     || defined TARGETOS_FreeBSD \
     || defined TARGETOS_NetBSD \
@@ -387,14 +409,33 @@ extern long double strtold (const char *__nptr, char **__endptr);
 # define CONFIG_NOOC_SEMLOCK 1
 #endif
 
+/* keep the global variables of the compiler (noocpp, noocgen,
+   <target>-gen ...) in thread local storage if the host compiler
+   supports it, so that different states can compile at the same time.
+   Otherwise nooc_enter_state() lets only one thread in at once. */
+#ifndef CONFIG_NOOC_TLS
+# if CONFIG_NOOC_SEMLOCK && (defined __GNUC__ && !defined __TINYC__ || defined _MSC_VER)
+#  define CONFIG_NOOC_TLS 1
+# else
+#  define CONFIG_NOOC_TLS 0
+# endif
+#endif
+#if !CONFIG_NOOC_TLS
+# define ST_TLS
+#elif defined _MSC_VER
+# define ST_TLS __declspec(thread)
+#else
+# define ST_TLS __thread
+#endif
+
 #if ONE_SOURCE
 #define ST_INLN static inline
 #define ST_FUNC static
-#define ST_DATA static
+#define ST_DATA static ST_TLS
 #else
 #define ST_INLN
 #define ST_FUNC
-#define ST_DATA extern
+#define ST_DATA extern ST_TLS
 #endif
 
 #ifdef NOOC_PROFILE /* profile all functions */
@@ -470,7 +511,7 @@ extern long double strtold (const char *__nptr, char **__endptr);
 #define TOKSTR_MAX_SIZE     256
 #define PACK_STACK_SIZE     8
 
-#define TOK_HASH_SIZE       16384 /* must be a power of two */
+#define TOK_HASH_SIZE       16384 /* initial, must be a power of two */
 #define TOK_ALLOC_INCR      512  /* must be a power of two */
 #define TOK_MAX_SIZE        4 /* token max size in int unit when stored in string */
 
@@ -546,7 +587,8 @@ struct SymAttr {
     dllimport   : 1,
     addrtaken   : 1,
     nodebug     : 1,
-    xxxx        : 2; /* not used */
+    constval    : 1, /* const scalar with a constant initializer */
+    inlinable   : 1; /* function whose calls may be inlined */
 };
 
 /* function attributes or temporary attributes for parsing */
@@ -587,6 +629,7 @@ typedef struct Sym {
         struct Sym *next; /* next related symbol (for fields and anoms) */
         struct Sym *cleanupstate; /* in defined labels */
         int asm_label; /* associated asm label */
+        intptr_t cval; /* value of a 'constval' local */
     };
     struct Sym *prev; /* prev symbol in stack */
     struct Sym *prev_tok; /* previous symbol for this token */
@@ -597,6 +640,7 @@ typedef struct Section {
     unsigned long data_offset; /* current data offset */
     unsigned char *data;       /* section data */
     unsigned long data_allocated; /* used for realloc() handling */
+    int data_mapped;           /* data is in an input file mapping */
     NOOCState *s1;
     int sh_name;             /* elf section name (only used during output) */
     int sh_num;              /* elf section number */
@@ -674,6 +718,10 @@ typedef struct BufferedFile {
     int include_next_index; /* next search path */
     char filename[1024];    /* filename */
     char *true_filename; /* filename not modified by # line directive */
+    int *pch_str; /* tokens of a precompiled header to replay at eof */
+    uint8_t *map; /* mmap()ed file data, see nooc_open_fd() */
+    size_t map_size;
+    uint64_t dev, ino; /* file identity, ino = 0 if unknown */
     unsigned char unget[4];
     unsigned char buffer[1]; /* extra size for CH_EOB char */
 } BufferedFile;
@@ -710,6 +758,8 @@ typedef struct AttributeDef {
 typedef struct InlineFunc {
     TokenString *func_str;
     Sym *sym;
+    Sym *call_sym; /* calls to it may be inlined, see gen_inline_call() */
+    int busy; /* func_str is being replayed */
     char filename[1];
 } InlineFunc;
 
@@ -718,11 +768,15 @@ typedef struct InlineFunc {
 typedef struct CachedInclude {
     int ifndef_macro;
     int once;
-    int hash_next; /* -1 if none */
+    int hash_next; /* 0 if none */
+    unsigned hash; /* of the basename */
+    uint64_t dev, ino; /* file identity, ino = 0 if unknown */
+    struct CachedInclude *ino_next; /* chain in cached_ino_hash */
     char filename[1]; /* path specified in #include */
 } CachedInclude;
 
-#define CACHED_INCLUDES_HASH_SIZE 32
+#define CACHED_INCLUDES_HASH_SIZE 32 /* initial, doubled as needed */
+#define CACHED_INO_HASH(dev, ino) ((unsigned)((ino) ^ (ino) >> 32 ^ (dev)))
 
 #ifdef CONFIG_NOOC_ASM
 typedef struct ExprValue {
@@ -769,8 +823,18 @@ struct NOOCState {
     unsigned char symbolic; /* if true, resolve symbols in the current module first */
     unsigned char filetype; /* file type for compilation (NONE,C,ASM) */
     unsigned char optimize; /* only to #define __OPTIMIZE__ */
+    unsigned char no_peephole; /* -fno-peephole */
+    unsigned char inline_functions; /* -finline-functions */
+    unsigned char tail_calls; /* -foptimize-sibling-calls */
+    unsigned char vectorize; /* -ftree-vectorize */
+    unsigned char function_sections; /* -ffunction-sections */
+    unsigned char data_sections; /* -fdata-sections */
     unsigned char option_pthread; /* -pthread option */
     unsigned char enable_new_dtags; /* -Wl,--enable-new-dtags */
+    unsigned char gc_sections; /* -Wl,--gc-sections */
+    unsigned char print_gc_sections; /* -Wl,--print-gc-sections */
+    unsigned char icf; /* -Wl,--icf=: 1 = safe, 2 = all */
+    unsigned char print_icf_sections; /* -Wl,--print-icf-sections */
     unsigned int  cversion; /* supported C ISO version, 199901 (the default), 201112, ... */
 
     /* C language options */
@@ -796,6 +860,8 @@ struct NOOCState {
     unsigned char just_deps; /* option -M  */
     unsigned char gen_deps; /* option -MD  */
     unsigned char include_sys_deps; /* option -MD  */
+    unsigned char gen_pch; /* option -pch */
+    unsigned char pp_digest; /* option -digest */
 
     /* compile with debug symbol (and use them if error during execution) */
     unsigned char do_debug;
@@ -817,6 +883,8 @@ struct NOOCState {
 
 #ifdef NOOC_TARGET_X86_64
     unsigned char nosse; /* For -mno-sse support. */
+    unsigned char avx; /* -mavx: 32 byte moves in inline memcpy/memset */
+    unsigned char avx2; /* -mavx2: 32 byte vectors in vectorized loops */
 #endif
 #ifdef NOOC_TARGET_ARM
     unsigned char float_abi; /* float ABI of the generated code*/
@@ -874,6 +942,8 @@ struct NOOCState {
     int error_set_jmp_enabled;
     jmp_buf error_jmp_buf;
     int nb_errors;
+    /* set while nooc_run_tasks() has worker threads: errors lock it */
+    struct NOOCTasks *tasks;
 
     /* output file for preprocessing (-E) */
     FILE *ppfp;
@@ -890,9 +960,12 @@ struct NOOCState {
     int *ifdef_stack_ptr;
 
     /* included files enclosed with #ifndef MACRO */
-    int cached_includes_hash[CACHED_INCLUDES_HASH_SIZE];
     CachedInclude **cached_includes;
     int nb_cached_includes;
+    int *cached_includes_hash;
+    CachedInclude **cached_ino_hash;
+    int cached_includes_hash_size;
+    unsigned incdir_id; /* for nooc_incdir_has() */
 
     /* #pragma pack stack */
     int pack_stack[PACK_STACK_SIZE];
@@ -900,6 +973,16 @@ struct NOOCState {
     char **pragma_libs;
     int nb_pragma_libs;
 
+    /* precompiled headers */
+    CString pch_data; /* nooc -pch: the .nch image to write */
+    void **pch_bufs; /* .nch files loaded by #include */
+    int nb_pch_bufs;
+    void **pch_maps; /* .nch files kept mapped, see pch_load() */
+    int nb_pch_maps;
+    void **input_maps; /* objects that sections use, see map_input() */
+    int nb_input_maps;
+    unsigned pch_ctx; /* hash of the predefined macros */
+
     /* inline functions are stored as token lists and compiled last
        only if referenced */
     struct InlineFunc **inline_fns;
@@ -1003,7 +1086,12 @@ struct NOOCState {
     int total_idents;
     int total_lines;
     unsigned int total_bytes;
+    unsigned int total_mapped;
     unsigned int total_output[4];
+    unsigned int include_hits; /* #includes skipped by their guard */
+    unsigned int include_misses; /* #includes read */
+    unsigned int incdir_reads; /* include directories listed */
+    unsigned int incdir_skips; /* open()s saved by the listings */
 
     /* option -dnum (for general development purposes) */
     int g_debug;
@@ -1020,6 +1108,7 @@ struct NOOCState {
     int nb_libraries; /* number of libs thereof */
     char *outfile; /* output filename */
     char *deps_outfile; /* option -MF */
+    int nb_jobs; /* option -j: max. number of parallel compilations */
     int argc;
     char **argv;
     CString linker_arg; /* collect -Wl options */
@@ -1145,6 +1234,8 @@ struct filespec {
 #define TOK_SHL     '<' /* shift left */
 #define TOK_SAR     '>' /* signed shift right */
 #define TOK_SHR     0x8b /* unsigned shift right */
+#define TOK_UMULH   0x8c /* high half of unsigned mul, see gen_divc() */
+#define TOK_SMULH   0x8d /* high half of signed mul */
 #define TOK_NEG     TOK_MID /* unary minus operation (for floats) */
 
 #define TOK_ARROW   0xa0 /* -> */
@@ -1187,8 +1278,9 @@ struct filespec {
 #define TOK_PPNUM   0xcd /* preprocessor number */
 #define TOK_PPSTR   0xce /* preprocessor string */
 #define TOK_LINENUM 0xcf /* line number info */
+#define TOK_PACK    0xd0 /* #pragma pack and ms-bitfields state */
 
-#define TOK_HAS_VALUE(t) (t >= TOK_CCHAR && t <= TOK_LINENUM)
+#define TOK_HAS_VALUE(t) (t >= TOK_CCHAR && t <= TOK_PACK)
 
 #define TOK_EOF       (-1)  /* end of file */
 #define TOK_LINEFEED  10    /* line feed */
@@ -1272,6 +1364,7 @@ ST_FUNC void nooc_close(void);
 #define cstr_free_s(cstr) (cstr_free(cstr), stk_pop())
 
 ST_FUNC int nooc_add_file_internal(NOOCState *s1, const char *filename, int flags);
+PUB_FUNC int nooc_filetype(int filetype, const char *filename);
 /* flags: */
 #define AFF_PRINT_ERROR     0x10 /* print error if file not found */
 #define AFF_REFERENCED_DLL  0x20 /* load a referenced dll from another dll */
@@ -1312,6 +1405,9 @@ ST_FUNC DLLReference *nooc_add_dllref(NOOCState *s1, const char *dllname, int le
 ST_FUNC char *nooc_load_text(int fd);
 /* for #pragma once */
 ST_FUNC int normalized_PATHCMP(const char *f1, const char *f2);
+ST_FUNC char *nooc_abspath(const char *f);
+ST_FUNC int nooc_incdir_has(NOOCState *s1, const char *dir, const char *name);
+PUB_FUNC void nooc_incdir_fill(NOOCState *s);
 
 /* nooc_parse_args return codes: */
 #define OPT_HELP 1
@@ -1389,6 +1485,8 @@ ST_FUNC void preprocess_end(NOOCState *s1);
 ST_FUNC void noocpp_new(NOOCState *s);
 ST_FUNC void noocpp_delete(NOOCState *s);
 ST_FUNC int nooc_preprocess(NOOCState *s1);
+ST_FUNC void nooc_pch_create(NOOCState *s1);
+ST_FUNC int nooc_pch_write(NOOCState *s1, const char *filename);
 ST_FUNC void skip(int c);
 ST_FUNC NORETURN void expect(const char *msg);
 
@@ -1429,6 +1527,10 @@ ST_DATA CType func_vt; /* current function return type (used by return instructi
 ST_DATA int func_var; /* true if current function is variadic */
 ST_DATA int func_vc;
 ST_DATA int func_ind;
+ST_DATA int func_regvars; /* -O1: number of locals gen_regvar() may keep in registers */
+ST_DATA int func_leaf; /* no call, alloca or asm in the function so far */
+ST_DATA int label_ind; /* last code address made a jump target, for the peephole optimizer */
+ST_DATA int no_constval; /* operand of '&' or asm: keep const variables as lvalues */
 ST_DATA const char *funcname;
 
 ST_FUNC void noocgen_init(NOOCState *s1);
@@ -1539,6 +1641,7 @@ ST_FUNC void section_realloc(Section *sec, unsigned long new_size);
 ST_FUNC size_t section_add(Section *sec, addr_t size, int align);
 ST_FUNC void *section_ptr_add(Section *sec, addr_t size);
 ST_FUNC Section *find_section(NOOCState *s1, const char *name);
+ST_FUNC Section *find_subsection(NOOCState *s1, Section *sec, const char *suffix);
 ST_FUNC Section *new_symtab(NOOCState *s1, const char *symtab_name, int sh_type, int sh_flags, const char *strtab_name, const char *hash_name, int hash_sh_flags);
 
 ST_FUNC int put_elf_str(Section *s, const char *sym);
@@ -1557,6 +1660,7 @@ ST_FUNC void *load_data(int fd, unsigned long file_offset, unsigned long size);
 ST_FUNC int nooc_object_type(int fd, ElfW(Ehdr) *h);
 ST_FUNC int nooc_load_object_file(NOOCState *s1, int fd, unsigned long file_offset);
 ST_FUNC int nooc_load_archive(NOOCState *s1, int fd, int alacarte);
+ST_FUNC void noocelf_end_input(NOOCState *s1);
 ST_FUNC void add_array(NOOCState *s1, const char *sec, int c);
 
 ST_FUNC struct sym_attr *get_sym_attr(NOOCState *s1, int index, int alloc);
@@ -1865,28 +1969,34 @@ ST_FUNC void nooc_tcov_reset_ind(NOOCState *s1);
 typedef struct { int init; CRITICAL_SECTION cr; } NOOCSem;
 #elif defined __APPLE__
 #include <dispatch/dispatch.h>
+#include <pthread.h>
 typedef struct { int init; dispatch_semaphore_t sem; } NOOCSem;
 #else
 #include <semaphore.h>
+#include <pthread.h>
 typedef struct { int init; sem_t sem; } NOOCSem;
 #endif
 ST_FUNC void wait_sem(NOOCSem *p);
 ST_FUNC void post_sem(NOOCSem *p);
+ST_FUNC void delete_sem(NOOCSem *p);
 #define NOOC_SEM(s) NOOCSem s
 #define WAIT_SEM wait_sem
 #define POST_SEM post_sem
+#define DELETE_SEM delete_sem
 #else
 #define NOOC_SEM(s)
 #define WAIT_SEM(p)
 #define POST_SEM(p)
+#define DELETE_SEM(p)
 #endif
+ST_FUNC void nooc_run_tasks(NOOCState *s1, int n, void (*fn)(void *arg, int i), void *arg);
 
 /********************************************************/
 #undef ST_DATA
 #if ONE_SOURCE
-#define ST_DATA static
+#define ST_DATA static ST_TLS
 #else
-#define ST_DATA
+#define ST_DATA ST_TLS
 #endif
 /********************************************************/
 
@@ -1907,6 +2017,7 @@ ST_FUNC void post_sem(NOOCSem *p);
 #define total_idents        NOOC_STATE_VAR(total_idents)
 #define total_lines         NOOC_STATE_VAR(total_lines)
 #define total_bytes         NOOC_STATE_VAR(total_bytes)
+#define total_mapped        NOOC_STATE_VAR(total_mapped)
 
 PUB_FUNC void nooc_enter_state(NOOCState *s1);
 PUB_FUNC void nooc_exit_state(NOOCState *s1);
@@ -32,6 +32,7 @@ static const char help[] =
     "  -c           compile only - generate an object file\n"
     "  -o outfile   set output filename\n"
     "  -run         run compiled source\n"
+    "  -j N         compile up to N files in parallel, relocate with N threads\n"
     "  -fflag       set or reset (with 'no-' prefix) 'flag' (see nooc -hh)\n"
     "  -std=c99     Conform to the ISO 1999 C standard (default).\n"
     "  -std=c11     Conform to the ISO 2011 C standard.\n"
@@ -48,6 +49,8 @@ static const char help[] =
     "  -Dsym[=val]  define 'sym' with value 'val'\n"
     "  -Usym        undefine 'sym'\n"
     "  -E           preprocess only\n"
+    "  -digest      preprocess, print the SHA-256 of the output of each file\n"
+    "  -pch         precompile header to .nch (use with #include \"file.nch\")\n"
     "Linker options:\n"
     "  -Ldir        add library path 'dir'\n"
     "  -llib        link with dynamic or static library 'lib'\n"
@@ -92,7 +95,7 @@ static const char help2[] =
     "  -P -P1                        with -E: no/alternative #line output\n"
     "  -dD -dM                       with -E: output #define directives\n"
     "  -pthread                      same as -D_REENTRANT and -lpthread\n"
-    "  -On                           same as -D__OPTIMIZE__ for n > 0\n"
+    "  -On                           for n > 0: -D__OPTIMIZE__, locals in registers\n"
     "  -Wp,-opt                      same as -opt\n"
     "  -include file                 include 'file' above each input file\n"
     "  -isystem dir                  add 'dir' to system include path\n"
@@ -117,6 +120,12 @@ static const char help2[] =
     "  ms-extensions                 allow anonymous struct in struct\n"
     "  dollars-in-identifiers        allow '$' in C symbols\n"
     "  test-coverage                 create code coverage code\n"
+    "  peephole                      remove redundant code (x86_64, default)\n"
+    "  inline-functions              expand calls of small static functions\n"
+    "  optimize-sibling-calls        jump to functions called by 'return'\n"
+    "  tree-vectorize                run simple loops on vectors (x86_64)\n"
+    "  function-sections             put each function in its own section\n"
+    "  data-sections                 put each variable in its own section\n"
     "-m... target specific options:\n"
     "  ms-bitfields                  use MSVC bitfield layout\n"
 #ifdef NOOC_TARGET_ARM
@@ -124,10 +133,16 @@ static const char help2[] =
 #endif
 #ifdef NOOC_TARGET_X86_64
     "  no-sse                        disable floats on x86_64\n"
+    "  avx                           use AVX moves to copy memory on x86_64\n"
+    "  avx2                          use AVX2 in vectorized loops (implies avx)\n"
 #endif
     "-Wl,... linker options:\n"
     "  -nostdlib                     do not link with standard crt/libs\n"
     "  -[no-]whole-archive           load lib(s) fully/only as needed\n"
+    "  -[no-]gc-sections             remove unreferenced sections (ELF)\n"
+    "  -print-gc-sections            list the sections removed\n"
+    "  -icf=[all safe none]          fold identical function sections\n"
+    "  -print-icf-sections           list the sections folded\n"
     "  -export-all-symbols           same as -rdynamic\n"
     "  -export-dynamic               same as -rdynamic\n"
     "  -image-base= -Ttext=          set base address of executable\n"
@@ -254,7 +269,9 @@ static char *default_outputfile(NOOCState *s, const char *first_file)
         strcpy(ext, ".exe");
     else
 #endif
-    if ((s->just_deps || s->output_type == NOOC_OUTPUT_OBJ) && !s->option_r && *ext)
+    if (s->gen_pch && *ext)
+        strcpy(ext, ".nch");
+    else if ((s->just_deps || s->output_type == NOOC_OUTPUT_OBJ) && !s->option_r && *ext)
         strcpy(ext, ".o");
     else
         strcpy(buf, "a.out");
@@ -272,10 +289,150 @@ static unsigned getclock_ms(void)
 #endif
 }
 
+#ifndef _WIN32
+#include <sys/wait.h>
+
+/* -j N: compile source files in up to N child processes.  With -c each
+   child does exactly what the serial loop below would do for its file.
+   Otherwise children compile into temporary objects which the parent
+   then links in command line order.  With -E they preprocess into
+   temporary files which the parent then copies to the output.  The
+   temporary files go to a private directory made by mkdtemp(), which
+   the parent removes on exit.  The include directories are listed
+   before the fork, so the children inherit the listings. */
+static int jobs_pid, jobs_nb;
+static char jobs_dir[1000]; /* leaves room for the file names */
+
+static void jobs_tmpname(char *buf, int size, int i)
+{
+    snprintf(buf, size, "%s/%d.o", jobs_dir, i);
+}
+
+static void jobs_cleanup(void)
+{
+    char buf[1024];
+    int i;
+
+    if (!jobs_dir[0] || getpid() != jobs_pid)
+        return; /* nothing to do, or in a child */
+    for (i = 0; i < jobs_nb; ++i)
+        jobs_tmpname(buf, sizeof buf, i), unlink(buf);
+    rmdir(jobs_dir);
+    jobs_dir[0] = 0;
+}
+
+static int jobs_is_source(NOOCState *s, int i)
+{
+    struct filespec *f = s->files[i];
+    if (f->type & AFF_TYPE_LIB)
+        return 0;
+    if (s->output_type == NOOC_OUTPUT_OBJ
+     || s->output_type == NOOC_OUTPUT_PREPROCESS)
+        return 1;
+    return !(nooc_filetype(f->type, f->name) & AFF_TYPE_BIN);
+}
+
+/* return the index of the file to compile in a child, in the parent
+   -1 when all children succeeded, -2 otherwise */
+static int compile_jobs(NOOCState *s)
+{
+    NOOCState *s1 = s;
+    const char *tmp;
+    int i, running, status, ret;
+    pid_t pid;
+
+    jobs_pid = getpid();
+    if (s->output_type != NOOC_OUTPUT_OBJ) {
+        tmp = getenv("TMPDIR");
+        if (!tmp || !*tmp)
+            tmp = "/tmp";
+        snprintf(jobs_dir, sizeof jobs_dir, "%s/nooc-XXXXXX", tmp);
+        if (!mkdtemp(jobs_dir)) {
+            nooc_error_noabort("could not create a directory in '%s': %s", tmp, strerror(errno));
+            jobs_dir[0] = 0;
+            return -2;
+        }
+        jobs_nb = s->nb_files;
+        atexit(jobs_cleanup);
+    }
+    nooc_incdir_fill(s);
+    fflush(stdout);
+    fflush(stderr);
+    for (i = running = 0, ret = -1;;) {
+        while (running && (running >= s->nb_jobs || i >= s->nb_files)) {
+            if (wait(&status) < 0)
+                break;
+            --running;
+            if (!WIFEXITED(status) || WEXITSTATUS(status))
+                ret = -2, i = s->nb_files; /* stop like the serial loop */
+        }
+        if (i >= s->nb_files)
+            break;
+        if (jobs_is_source(s, i)) {
+            pid = fork();
+            if (pid == 0)
+                return i;
+            if (pid < 0) {
+                nooc_error_noabort("could not fork: %s", strerror(errno));
+                ret = -2, i = s->nb_files;
+                continue;
+            }
+            ++running;
+        }
+        ++i;
+    }
+    return ret;
+}
+
+/* after a linking compile_jobs(): replace sources by their objects */
+static void jobs_use_objects(NOOCState *s)
+{
+    char buf[1024];
+    struct filespec *f;
+    int i;
+
+    for (i = 0; i < s->nb_files; ++i) {
+        if (!jobs_is_source(s, i))
+            continue;
+        jobs_tmpname(buf, sizeof buf, i);
+        f = nooc_malloc(sizeof *f + strlen(buf));
+        f->type = AFF_TYPE_BIN | (s->files[i]->type & ~AFF_TYPE_MASK);
+        strcpy(f->name, buf);
+        nooc_free(s->files[i]);
+        s->files[i] = f;
+    }
+}
+
+/* after a preprocessing compile_jobs(): copy the outputs in order */
+static int jobs_cat(NOOCState *s, FILE *out)
+{
+    NOOCState *s1 = s;
+    char buf[8192];
+    FILE *in;
+    size_t len;
+    int i, ret = 0;
+
+    for (i = 0; i < s->nb_files; ++i) {
+        if (!jobs_is_source(s, i))
+            continue;
+        jobs_tmpname(buf, sizeof buf, i);
+        in = fopen(buf, "rb");
+        if (!in) {
+            ret = nooc_error_noabort("could not read '%s'", buf);
+            continue;
+        }
+        while ((len = fread(buf, 1, sizeof buf, in)) > 0)
+            fwrite(buf, 1, len, out);
+        fclose(in);
+    }
+    return ret;
+}
+#endif
+
 int main(int argc0, char **argv0)
 {
-    NOOCState *s, *s1;
-    int ret, opt, n = 0, t = 0, done;
+    NOOCState *s, *s1, *s0 = NULL;
+    int ret, opt, n = 0, t = 0, done, job = -1;
     unsigned start_time = 0, end_time = 0;
     const char *first_file;
     int argc; char **argv;
@@ -284,6 +441,8 @@ int main(int argc0, char **argv0)
 redo:
     argc = argc0, argv = argv0;
     s = s1 = nooc_new();
+    if (s0)
+        nooc_delete(s0), s0 = NULL;
 #ifdef CONFIG_NOOC_SWITCHES /* predefined options */
     nooc_set_options(s, CONFIG_NOOC_SWITCHES);
 #endif
@@ -340,9 +499,45 @@ redo:
             return 1;
         if (s->do_bench)
             start_time = getclock_ms();
+        set_environment(s);
+#ifndef _WIN32
+        if (s->nb_jobs > 1 && s->nb_files > 1
+         && (s->output_type == NOOC_OUTPUT_OBJ ? !s->option_r
+             : s->output_type == NOOC_OUTPUT_PREPROCESS ? !(s->dflag & 16)
+             : s->output_type != NOOC_OUTPUT_MEMORY && !s->gen_deps)) {
+            job = compile_jobs(s);
+            if (job >= 0) {
+                /* in a child: compile files[job] only */
+                n = job;
+                if (s->output_type == NOOC_OUTPUT_PREPROCESS) {
+                    char buf[1024];
+                    jobs_tmpname(buf, sizeof buf, job);
+                    ppfp = fopen(buf, "w");
+                    if (!ppfp)
+                        return 1;
+                } else if (s->output_type != NOOC_OUTPUT_OBJ) {
+                    char buf[1024];
+                    jobs_tmpname(buf, sizeof buf, job);
+                    nooc_free(s->outfile);
+                    s->outfile = nooc_strdup(buf);
+                    s->output_type = NOOC_OUTPUT_OBJ;
+                }
+            } else if (job == -2 || s->output_type == NOOC_OUTPUT_OBJ
+                       || s->output_type == NOOC_OUTPUT_PREPROCESS) {
+                if (job == -1 && s->output_type == NOOC_OUTPUT_PREPROCESS)
+                    job = jobs_cat(s, ppfp) ? -2 : -1;
+                jobs_cleanup();
+                nooc_delete(s);
+                if (ppfp != stdout)
+                    fclose(ppfp);
+                return job == -2;
+            } else {
+                jobs_use_objects(s);
+            }
+        }
+#endif
     }
 
-    set_environment(s);
     if (s->output_type == 0)
         s->output_type = NOOC_OUTPUT_EXE;
     nooc_set_output_type(s, s->output_type);
@@ -374,7 +569,7 @@ redo:
             if (nooc_add_file(s, f->name) < 0)
                 ret = 1;
         }
-        done = ret || ++n >= s->nb_files;
+        done = ret || ++n >= s->nb_files || job >= 0;
     } while (!done && (s->output_type != NOOC_OUTPUT_OBJ || s->option_r));
 
     if (s->do_bench)
@@ -402,9 +597,17 @@ redo:
     if (done && 0 == t && 0 == ret && s->do_bench)
         nooc_print_stats(s, end_time - start_time);
 
+#ifndef _WIN32
+    if (job == -1)
+        jobs_cleanup(); /* remove objects from a linking -j run */
+#endif
+    if (!done) {
+        /* compile more files with -c.  The state is deleted after the
+           next one is made, which keeps the include directory cache. */
+        s0 = s;
+        goto redo;
+    }
     nooc_delete(s);
-    if (!done)
-        goto redo; /* compile more files with -c */
     if (t)
         goto redo; /* run more tests with -dt -run */
 
@@ -22,8 +22,8 @@
 #include "nooc.h"
 #ifdef CONFIG_NOOC_ASM
 
-static Section *last_text_section; /* to handle .previous asm directive */
-static int asmgoto_n;
+static ST_TLS Section *last_text_section; /* to handle .previous asm directive */
+static ST_TLS int asmgoto_n;
 
 static int asm_get_prefix_name(NOOCState *s1, const char *prefix, unsigned int n)
 {
@@ -1135,7 +1135,9 @@ static void parse_asm_operands(ASMOperand *operands, int *nb_operands_ptr,
 	    astr = parse_mult_str("string constant")->data;
             pstrcpy(op->constraint, sizeof op->constraint, astr);
             skip('(');
+            ++no_constval;
             gexpr();
+            --no_constval;
             if (is_output) {
                 if (!(vtop->type.t & VT_ARRAY))
                     test_lvalue();
@@ -1183,6 +1185,8 @@ ST_FUNC void asm_instr(void)
     astr1 = parse_asm_str();
     cstr_new_s(&astr);
     cstr_cat(&astr, astr1->data, astr1->size);
+    /* the code may call or push */
+    func_leaf = 0;
 
     nb_operands = 0;
     nb_outputs = 0;
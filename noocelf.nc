@@ -97,7 +97,8 @@ ST_FUNC void noocelf_bounds_new(NOOCState *s)
 
 static void free_section(Section *s)
 {
-    nooc_free(s->data);
+    if (!s->data_mapped)
+        nooc_free(s->data);
 }
 
 ST_FUNC void noocelf_delete(NOOCState *s1)
@@ -123,6 +124,14 @@ ST_FUNC void noocelf_delete(NOOCState *s1)
         free_section(s1->priv_sections[i]);
     dynarray_reset(&s1->priv_sections, &s1->nb_priv_sections);
 
+#if CONFIG_NOOC_MMAP
+    for (i = 0; i < s1->nb_input_maps; i += 2)
+        munmap(s1->input_maps[i], (size_t)s1->input_maps[i + 1]);
+#endif
+    nooc_free(s1->input_maps);
+    s1->input_maps = NULL;
+    s1->nb_input_maps = 0;
+
     /* free any loaded DLLs */
 #ifdef NOOC_IS_NATIVE
     for ( i = 0; i < s1->nb_loaded_dlls; i++) {
@@ -284,7 +293,13 @@ ST_FUNC void section_realloc(Section *sec, unsigned long new_size)
         size = 1;
     while (size < new_size)
         size = size * 2;
-    data = nooc_realloc(sec->data, size);
+    if (sec->data_mapped) {
+        /* copy it out of the input file */
+        data = nooc_malloc(size);
+        memcpy(data, sec->data, sec->data_allocated);
+        sec->data_mapped = 0;
+    } else
+        data = nooc_realloc(sec->data, size);
     memset(data + sec->data_allocated, 0, size - sec->data_allocated);
     sec->data = data;
     sec->data_allocated = size;
@@ -348,6 +363,23 @@ ST_FUNC Section *find_section(NOOCState *s1, const char *name)
     return new_section(s1, name, SHT_PROGBITS, SHF_ALLOC);
 }
 
+/* return the section '<sec>.<suffix>' of -ffunction-sections and
+   -fdata-sections, created like 'sec' if it does not exist */
+ST_FUNC Section *find_subsection(NOOCState *s1, Section *sec, const char *suffix)
+{
+    char buf[256];
+    Section *s;
+
+    snprintf(buf, sizeof buf, "%s.%s", sec->name, suffix);
+    s = have_section(s1, buf);
+    if (!s) {
+        s = new_section(s1, buf, sec->sh_type, sec->sh_flags);
+        /* raised by section_add(), so as to pack like 'sec' when folded */
+        s->sh_addralign = 1;
+    }
+    return s;
+}
+
 /* ------------------------------------------------------------------------- */
 
 ST_FUNC int put_elf_str(Section *s, const char *sym)
@@ -1082,19 +1114,16 @@ ST_FUNC void relocate_syms(NOOCState *s1, Section *symtab, int do_resolve)
     }
 }
 
-/* relocate a given section (CPU dependent) by applying the relocations
-   in the associated relocation section */
-static void relocate_section(NOOCState *s1, Section *s, Section *sr)
+/* apply the relocations rel ... rel_end - 1 to section 's' */
+static void relocate_rels(NOOCState *s1, Section *s, ElfW_Rel *rel, ElfW_Rel *rel_end)
 {
-    ElfW_Rel *rel;
     ElfW(Sym) *sym;
     int type, sym_index;
     unsigned char *ptr;
     addr_t tgt, addr;
     int is_dwarf = s->sh_num >= s1->dwlo && s->sh_num < s1->dwhi;
 
-    qrel = (ElfW_Rel *)sr->data;
-    for_each_elem(sr, 0, rel, ElfW_Rel) {
+    for (; rel < rel_end; rel++) {
         ptr = s->data + rel->r_offset;
         sym_index = ELFW(R_SYM)(rel->r_info);
         sym = &((ElfW(Sym) *)symtab_section->data)[sym_index];
@@ -1112,6 +1141,16 @@ static void relocate_section(NOOCState *s1, Section *s, Section *sr)
         addr = s->sh_addr + rel->r_offset;
         relocate(s1, rel, type, ptr, addr, tgt);
     }
+}
+
+/* relocate a given section (CPU dependent) by applying the relocations
+   in the associated relocation section, unless 'done' already did */
+static void relocate_section(NOOCState *s1, Section *s, Section *sr, int done)
+{
+    qrel = (ElfW_Rel *)sr->data;
+    if (!done)
+        relocate_rels(s1, s, (ElfW_Rel *)sr->data,
+                      (ElfW_Rel *)(sr->data + sr->data_offset));
 #ifndef ELF_OBJ_ONLY
     /* if the relocation is allocated, we change its symbol table */
     if (sr->sh_flags & SHF_ALLOC) {
@@ -1131,25 +1170,125 @@ static void relocate_section(NOOCState *s1, Section *s, Section *sr)
 #endif
 }
 
+static int relocate_this(NOOCState *s1, Section *s)
+{
+#ifndef NOOC_TARGET_MACHO
+    return s != s1->got
+        || s1->static_link
+        || s1->output_type == NOOC_OUTPUT_MEMORY;
+#else
+    return 1;
+#endif
+}
+
+#if RELOCATE_PARALLEL
+/* With -j N the relocations of an executable are applied from N threads
+   (shared objects and PIEs are not: relocate() appends their dynamic
+   relocations to 'qrel' in order).  A task is a run of relocations of
+   one section.  Long runs are cut only in sections with sorted offsets
+   and where the next offset is far enough: relocate() writes one word
+   in data, but may rewrite the instructions around its target in code
+   (TLS models, which also patch the following entry).  Tasks so touch
+   disjoint bytes and the output does not depend on the thread schedule. */
+#define RELOC_CHUNK 8192
+#define RELOC_GAP_DATA 8
+#define RELOC_GAP_CODE 16
+
+typedef struct RelocTask {
+    Section *s;
+    ElfW_Rel *rel, *rel_end;
+} RelocTask;
+
+typedef struct RelocTasks {
+    NOOCState *s1;
+    RelocTask *t;
+    int n;
+} RelocTasks;
+
+static void relocate_task(void *arg, int i)
+{
+    RelocTasks *rt = arg;
+    RelocTask *t = &rt->t[i];
+    relocate_rels(rt->s1, t->s, t->rel, t->rel_end);
+}
+
+static void add_reloc_task(RelocTasks *rt, Section *s, ElfW_Rel *rel, ElfW_Rel *rel_end)
+{
+    RelocTask *t;
+    if ((rt->n & (rt->n - 1)) == 0)
+        rt->t = nooc_realloc(rt->t, (rt->n ? rt->n * 2 : 1) * sizeof *t);
+    t = &rt->t[rt->n++];
+    t->s = s, t->rel = rel, t->rel_end = rel_end;
+}
+
+/* returns nonzero if the relocations were applied */
+static int relocate_parallel(NOOCState *s1)
+{
+    RelocTasks rt;
+    ElfW_Rel *rel, *rel0, *rel_end;
+    Section *s, *sr;
+    int i, sorted, gap;
+    size_t nb_rels = 0;
+
+    for (i = 1; i < s1->nb_sections; ++i) {
+        sr = s1->sections[i];
+        if (sr->sh_type == SHT_RELX)
+            nb_rels += sr->data_offset / sizeof (ElfW_Rel);
+    }
+    if (nb_rels < 2 * RELOC_CHUNK)
+        return 0;
+
+    memset(&rt, 0, sizeof rt);
+    rt.s1 = s1;
+    for (i = 1; i < s1->nb_sections; ++i) {
+        sr = s1->sections[i];
+        if (sr->sh_type != SHT_RELX || 0 == sr->data_offset)
+            continue;
+        s = s1->sections[sr->sh_info];
+        if (!relocate_this(s1, s))
+            continue;
+        rel0 = (ElfW_Rel *)sr->data;
+        rel_end = (ElfW_Rel *)(sr->data + sr->data_offset);
+        sorted = 1;
+        for (rel = rel0 + 1; sorted && rel < rel_end; rel++)
+            sorted = rel[-1].r_offset <= rel->r_offset;
+        gap = s->sh_flags & SHF_EXECINSTR ? RELOC_GAP_CODE : RELOC_GAP_DATA;
+        if (sorted) {
+            for (rel = rel0 + RELOC_CHUNK; rel < rel_end; rel++) {
+                if (rel->r_offset - rel[-1].r_offset >= gap) {
+                    add_reloc_task(&rt, s, rel0, rel);
+                    rel0 = rel;
+                    if (rel_end - rel <= RELOC_CHUNK)
+                        break;
+                    rel += RELOC_CHUNK - 1;
+                }
+            }
+        }
+        add_reloc_task(&rt, s, rel0, rel_end);
+    }
+    nooc_run_tasks(s1, rt.n, relocate_task, &rt);
+    nooc_free(rt.t);
+    return 1;
+}
+#endif
+
 /* relocate all sections */
 ST_FUNC void relocate_sections(NOOCState *s1)
 {
-    int i;
+    int i, done = 0;
     Section *s, *sr;
 
+#if RELOCATE_PARALLEL
+    if (s1->nb_jobs > 1 && !(s1->output_type & NOOC_OUTPUT_DYN))
+        done = relocate_parallel(s1);
+#endif
     for (i = 1; i < s1->nb_sections; ++i) {
         sr = s1->sections[i];
         if (sr->sh_type != SHT_RELX)
             continue;
         s = s1->sections[sr->sh_info];
-#ifndef NOOC_TARGET_MACHO
-        if (s != s1->got
-            || s1->static_link
-            || s1->output_type == NOOC_OUTPUT_MEMORY)
-#endif
-        {
-            relocate_section(s1, s, sr);
-        }
+        if (relocate_this(s1, s))
+            relocate_section(s1, s, sr, done);
 #ifndef ELF_OBJ_ONLY
         if (sr->sh_flags & SHF_ALLOC) {
             ElfW_Rel *rel;
@@ -2008,6 +2147,384 @@ static void export_global_syms(NOOCState *s1)
     }
 }
 
+/* how --gc-sections treats a section: 1 for the roots of the marking,
+   0 for the sections removed when nothing reachable refers to them,
+   -1 for the others (relocations, debug info), which are left alone */
+static int gc_section_kind(NOOCState *s1, Section *s)
+{
+    /* used by the runtime without any reference */
+    static const char * const keep[] = {
+        ".init", ".fini", ".ctors", ".dtors", ".preinit_array",
+        ".init_array", ".fini_array", ".eh_frame", ".jcr", ".note", NULL
+    };
+    const char * const *k;
+    const char *p;
+    size_t l;
+
+    if (s->sh_type == SHT_RELX || !(s->sh_flags & SHF_ALLOC))
+        return -1;
+    if (s->sh_type != SHT_PROGBITS && s->sh_type != SHT_NOBITS)
+        return 1;
+    for (k = keep; *k; k++) {
+        l = strlen(*k);
+        if (!strncmp(s->name, *k, l) && (!s->name[l] || s->name[l] == '.'))
+            return 1;
+    }
+#ifdef CONFIG_NOOC_BCHECK
+    if (s == bounds_section || s == lbounds_section)
+        return 1;
+#endif
+    /* fold_sections() appends to the standard sections, and the linker
+       defines _etext, _edata and _end and puts R_COPY objects there */
+    if (s == text_section || s == rodata_section || s == data_section
+        || s == bss_section || s == tcov_section)
+        return 1;
+    /* sections of C name are reached through __start_ and __stop_ */
+    for (p = s->name; isid(*p) || isnum(*p); p++)
+        ;
+    return !*p;
+}
+
+/* whether the global 'sym' is visible to the dynamic linker */
+static int sym_exported(NOOCState *s1, ElfW(Sym) *sym)
+{
+    const char *name = (char *) symtab_section->link->data + sym->st_name;
+    return s1->rdynamic || s1->output_type == NOOC_OUTPUT_DLL
+        || (!s1->static_link && find_elf_sym(s1->dynsymtab_section, name));
+}
+
+/* empty 's' and its relocations so that it is not output */
+static void remove_section(Section *s)
+{
+    s->data_offset = 0;
+    s->sh_flags &= ~SHF_ALLOC;
+    if (s->reloc)
+        s->reloc->data_offset = 0;
+}
+
+/* remove the allocated sections that nothing refers to, following the
+   relocations from the roots: the entry point, the exported symbols and
+   the sections that gc_section_kind() keeps.  The symbols of removed
+   sections become absolute zeros. */
+static void gc_sections(NOOCState *s1)
+{
+    int i, n, sp, *stack;
+    unsigned char *live;
+    const char *name, *entry;
+    Section *s;
+    ElfW(Sym) *sym;
+    ElfW_Rel *rel;
+
+    n = s1->nb_sections;
+    live = nooc_mallocz(n);
+    stack = nooc_malloc(n * sizeof *stack);
+    sp = 0;
+    for (i = 1; i < n; i++)
+        if (gc_section_kind(s1, s1->sections[i]) > 0)
+            live[i] = 1, stack[sp++] = i;
+
+    entry = s1->elf_entryname ? s1->elf_entryname : "_start";
+    for_each_elem(symtab_section, 1, sym, ElfW(Sym)) {
+        i = sym->st_shndx;
+        if (i == SHN_UNDEF || i >= SHN_LORESERVE || live[i]
+            || ELFW(ST_BIND)(sym->st_info) == STB_LOCAL)
+            continue;
+        name = (char *) symtab_section->link->data + sym->st_name;
+        if (!strcmp(name, entry) || sym_exported(s1, sym))
+            live[i] = 1, stack[sp++] = i;
+    }
+
+    while (sp) {
+        s = s1->sections[stack[--sp]];
+        if (!s->reloc)
+            continue;
+        for_each_elem(s->reloc, 0, rel, ElfW_Rel) {
+            sym = (ElfW(Sym) *) symtab_section->data + ELFW(R_SYM)(rel->r_info);
+            i = sym->st_shndx;
+            if (i != SHN_UNDEF && i < SHN_LORESERVE && !live[i])
+                live[i] = 1, stack[sp++] = i;
+        }
+    }
+
+    for (i = 1; i < n; i++) {
+        s = s1->sections[i];
+        if (live[i] || gc_section_kind(s1, s) < 0) {
+            live[i] = 1;
+            continue;
+        }
+        if (s1->print_gc_sections && s->data_offset)
+            fprintf(stderr, "removing unused section '%s'\n", s->name);
+        remove_section(s);
+    }
+    for_each_elem(symtab_section, 1, sym, ElfW(Sym)) {
+        i = sym->st_shndx;
+        if (i != SHN_UNDEF && i < SHN_LORESERVE && !live[i])
+            sym->st_shndx = SHN_ABS, sym->st_value = 0;
+    }
+    nooc_free(stack);
+    nooc_free(live);
+}
+
+/* whether 'rel' of 's' only calls or jumps to its symbol, which then
+   needs no address of its own for --icf=safe */
+static int icf_call_reloc(Section *s, ElfW_Rel *rel)
+{
+#if defined NOOC_TARGET_I386 || defined NOOC_TARGET_X86_64
+    unsigned char *p = s->data + rel->r_offset;
+    int type = ELFW(R_TYPE)(rel->r_info);
+# ifdef NOOC_TARGET_X86_64
+    if (type == R_X86_64_PLT32)
+        return 1;
+    if (type != R_X86_64_PC32)
+        return 0;
+# else
+    if (type != R_386_PC32 && type != R_386_PLT32)
+        return 0;
+# endif
+    /* call, jmp or jcc with a 32 bit displacement */
+    return (rel->r_offset >= 1 && (p[-1] == 0xe8 || p[-1] == 0xe9))
+        || (rel->r_offset >= 2 && p[-2] == 0x0f && (p[-1] & 0xf0) == 0x80);
+#else
+    return 0;
+#endif
+}
+
+/* what 'rel' of section 'i' refers to: its offset and type, and a section
+   (0 for 'i' itself) and offset, or else a symbol */
+static void icf_key(NOOCState *s1, int i, int *rep, ElfW_Rel *rel, addr_t *key)
+{
+    int t, sym_index = ELFW(R_SYM)(rel->r_info);
+    ElfW(Sym) *sym = (ElfW(Sym) *) symtab_section->data + sym_index;
+
+    key[0] = rel->r_offset;
+    key[1] = ELFW(R_TYPE)(rel->r_info);
+    key[2] = s1->nb_sections + sym_index;
+    key[3] = 0;
+#if SHT_RELX == SHT_RELA
+    key[3] = rel->r_addend;
+#endif
+    t = sym->st_shndx;
+    if (t != SHN_UNDEF && t < SHN_LORESERVE) {
+        while (rep[t] != t)
+            t = rep[t];
+        key[2] = t == i ? 0 : t;
+        key[3] += sym->st_value;
+    }
+}
+
+static unsigned icf_hash(NOOCState *s1, int i, int *rep)
+{
+    Section *s = s1->sections[i];
+    ElfW_Rel *rel;
+    addr_t key[4];
+    unsigned h = 2166136261u;
+    unsigned char *p, *e;
+
+    for (p = s->data, e = p + s->data_offset; p < e; p++)
+        h = (h ^ *p) * 16777619;
+    if (s->reloc) {
+        for_each_elem(s->reloc, 0, rel, ElfW_Rel) {
+            icf_key(s1, i, rep, rel, key);
+            for (p = (unsigned char *) key, e = p + sizeof key; p < e; p++)
+                h = (h ^ *p) * 16777619;
+        }
+    }
+    return h;
+}
+
+static int icf_equal(NOOCState *s1, int i, int j, int *rep)
+{
+    Section *a = s1->sections[i], *b = s1->sections[j];
+    ElfW_Rel *ra, *rb;
+    addr_t ka[4], kb[4];
+    unsigned long n;
+
+    if (a->sh_flags != b->sh_flags || a->data_offset != b->data_offset
+        || memcmp(a->data, b->data, a->data_offset))
+        return 0;
+    n = a->reloc ? a->reloc->data_offset : 0;
+    if (n != (b->reloc ? b->reloc->data_offset : 0))
+        return 0;
+    if (!n)
+        return 1;
+    ra = (ElfW_Rel *) a->reloc->data;
+    rb = (ElfW_Rel *) b->reloc->data;
+    for (n /= sizeof *ra; n; n--, ra++, rb++) {
+        icf_key(s1, i, rep, ra, ka);
+        icf_key(s1, j, rep, rb, kb);
+        if (memcmp(ka, kb, sizeof ka))
+            return 0;
+    }
+    return 1;
+}
+
+/* fold the identical code sections of -ffunction-sections into the first
+   of them: same bytes and relocations to the same places, a reference to
+   the section itself matching one to the other.  This is repeated while
+   sections are folded, since callers of folded functions can become
+   identical.  --icf=safe leaves apart the functions whose address is
+   taken or exported, which C requires to be distinct. */
+static void icf_sections(NOOCState *s1)
+{
+    int i, j, k, n, changed, *rep, *table;
+    unsigned h, nt, *hash;
+    unsigned char *cand;
+    Section *s, *sr;
+    ElfW(Sym) *sym;
+    ElfW_Rel *rel;
+
+    n = s1->nb_sections;
+    rep = nooc_malloc(n * sizeof *rep);
+    hash = nooc_malloc(n * sizeof *hash);
+    cand = nooc_mallocz(n);
+    rep[0] = 0;
+    for (i = 1, k = 0; i < n; i++) {
+        s = s1->sections[i];
+        rep[i] = i;
+        if (s->sh_type == SHT_PROGBITS && (s->sh_flags & SHF_EXECINSTR)
+            && s->data_offset && gc_section_kind(s1, s) == 0)
+            cand[i] = 1, k++;
+    }
+
+    if (s1->icf == 1) {
+        for (i = 1; i < n; i++) {
+            sr = s1->sections[i];
+            if (sr->sh_type != SHT_RELX || sr->link != symtab_section)
+                continue;
+            s = s1->sections[sr->sh_info];
+            if (!(s->sh_flags & SHF_ALLOC))
+                continue;
+            for_each_elem(sr, 0, rel, ElfW_Rel) {
+                sym = (ElfW(Sym) *) symtab_section->data + ELFW(R_SYM)(rel->r_info);
+                j = sym->st_shndx;
+                if (j < n && cand[j] && !icf_call_reloc(s, rel))
+                    cand[j] = 0;
+            }
+        }
+        for_each_elem(symtab_section, 1, sym, ElfW(Sym)) {
+            j = sym->st_shndx;
+            if (j < n && cand[j] && ELFW(ST_BIND)(sym->st_info) != STB_LOCAL
+                && sym_exported(s1, sym))
+                cand[j] = 0;
+        }
+    }
+
+    for (nt = 16; nt < 2 * k; nt *= 2)
+        ;
+    table = nooc_malloc(nt * sizeof *table);
+    do {
+        changed = 0;
+        memset(table, 0, nt * sizeof *table);
+        for (i = 1; i < n; i++) {
+            if (!cand[i])
+                continue;
+            h = hash[i] = icf_hash(s1, i, rep);
+            for (j = h & (nt - 1); table[j]; j = (j + 1) & (nt - 1))
+                if (hash[table[j]] == h && icf_equal(s1, table[j], i, rep))
+                    break;
+            if (table[j])
+                rep[i] = table[j], cand[i] = 0, changed = 1;
+            else
+                table[j] = i;
+        }
+    } while (changed);
+
+    for (i = 1; i < n; i++)
+        while (rep[i] != rep[rep[i]])
+            rep[i] = rep[rep[i]];
+    for_each_elem(symtab_section, 1, sym, ElfW(Sym)) {
+        i = sym->st_shndx;
+        if (i < n)
+            sym->st_shndx = rep[i];
+    }
+    for (i = 1; i < n; i++) {
+        if (rep[i] == i)
+            continue;
+        s = s1->sections[i];
+        sr = s1->sections[rep[i]];
+        if (s1->print_icf_sections)
+            fprintf(stderr, "folding section '%s' into '%s'\n", s->name, sr->name);
+        if (s->sh_addralign > sr->sh_addralign)
+            sr->sh_addralign = s->sh_addralign;
+        remove_section(s);
+    }
+    nooc_free(table);
+    nooc_free(cand);
+    nooc_free(hash);
+    nooc_free(rep);
+}
+
+/* the standard section that fold_sections() appends 's' to */
+static Section *fold_target(NOOCState *s1, Section *s)
+{
+    Section *t[4];
+    int i;
+    size_t l;
+
+    /* .data.ro before .data, and .data.rel.ro stays apart for RELRO */
+    t[0] = text_section, t[1] = rodata_section;
+    t[2] = data_section, t[3] = bss_section;
+    for (i = 0; i < 4; i++)
+        if (s == t[i])
+            return NULL;
+    if (!strncmp(s->name, ".data.rel.ro", 12))
+        return NULL;
+    for (i = 0; i < 4; i++) {
+        l = strlen(t[i]->name);
+        if (!strncmp(s->name, t[i]->name, l) && s->name[l] == '.')
+            return s->sh_type == t[i]->sh_type
+                && s->sh_flags == t[i]->sh_flags ? t[i] : NULL;
+    }
+    return NULL;
+}
+
+/* append the sections named after a standard section, such as the
+   .text.<function> of -ffunction-sections, to that section as GNU ld
+   does, so that the output has no header per function */
+static void fold_sections(NOOCState *s1)
+{
+    int i, n;
+    Section *s, *d, **dst;
+    addr_t *off;
+    ElfW(Sym) *sym;
+    ElfW_Rel *rel;
+
+    n = s1->nb_sections;
+    dst = nooc_mallocz(n * sizeof *dst);
+    off = nooc_mallocz(n * sizeof *off);
+    for (i = 1; i < n; i++) {
+        s = s1->sections[i];
+        d = fold_target(s1, s);
+        if (!d)
+            continue;
+        off[i] = section_add(d, s->data_offset, s->sh_addralign);
+        if (s->sh_type != SHT_NOBITS)
+            memcpy(d->data + off[i], s->data, s->data_offset);
+        if (s->reloc) {
+            for_each_elem(s->reloc, 0, rel, ElfW_Rel)
+                rel->r_offset += off[i];
+            if (d->reloc) {
+                memcpy(section_ptr_add(d->reloc, s->reloc->data_offset),
+                       s->reloc->data, s->reloc->data_offset);
+                s->reloc->data_offset = 0;
+            } else {
+                d->reloc = s->reloc;
+                d->reloc->sh_info = d->sh_num;
+            }
+            s->reloc = NULL;
+        }
+        remove_section(s);
+        dst[i] = d;
+    }
+    for_each_elem(symtab_section, 1, sym, ElfW(Sym)) {
+        i = sym->st_shndx;
+        if (i < n && dst[i])
+            sym->st_shndx = dst[i]->sh_num, sym->st_value += off[i];
+    }
+    nooc_free(off);
+    nooc_free(dst);
+}
+
 /* decide if an unallocated section should be output. */
 static int set_sec_sizes(NOOCState *s1)
 {
@@ -2120,7 +2637,9 @@ static int sort_sections(NOOCState *s1, int *sec_order, Section *interp)
         } else if (s == bounds_section || s == lbounds_section) {
             k = 0x44;
 #endif
-        } else if (s == rodata_section || 0 == strcmp(s->name, ".data.rel.ro")) {
+        } else if (s == rodata_section || 0 == strcmp(s->name, ".data.rel.ro")
+                   || (!strncmp(s->name, rdata, sizeof rdata - 1)
+                       && s->name[sizeof rdata - 1] == '.')) {
             k = 0x45;
         } else if (s->sh_type == SHT_DYNAMIC) {
             k = 0x46;
@@ -2768,6 +3287,11 @@ static int elf_output_file(NOOCState *s1, const char *filename)
 #endif
         /* if linking, also link in runtime libraries (libc, libgcc, etc.) */
         nooc_add_runtime(s1);
+        if (s1->gc_sections)
+            gc_sections(s1);
+        if (s1->icf)
+            icf_sections(s1);
+        fold_sections(s1);
 	resolve_common_syms(s1);
 
         if (!s1->static_link) {
@@ -2944,6 +3468,8 @@ LIBNOOCAPI int nooc_output_file(NOOCState *s, const char *filename)
 {
     if (s->test_coverage)
         nooc_tcov_add_file(s, filename);
+    if (s->gen_pch)
+        return nooc_pch_write(s, filename);
     if (s->output_type == NOOC_OUTPUT_OBJ)
         return elf_output_obj(s, filename);
 #ifdef NOOC_TARGET_PE
@@ -2977,6 +3503,115 @@ ST_FUNC void *load_data(int fd, unsigned long file_offset, unsigned long size)
     return data;
 }
 
+/* The object or archive being loaded is mapped once (private, so that
+   the headers and symbols can be patched in place), and its headers,
+   symbols and section contents are taken from memory instead of being
+   read() piece by piece.  A section that starts an output section uses
+   the mapping as its data: only the pages that relocations write are
+   copied, and the mapping is then kept until nooc_delete(). */
+static ST_TLS uint8_t *in_map;
+static ST_TLS unsigned long in_map_size;
+static ST_TLS int in_map_fd = -1;
+static ST_TLS int in_map_kept; /* sections use it */
+
+/* map fd if it is a large regular file and nothing is mapped yet,
+   return 1 if so */
+static int map_input(int fd)
+{
+#if CONFIG_NOOC_MMAP
+    struct stat st;
+    void *p;
+
+    /* small files are read faster */
+    if (in_map || fstat(fd, &st) || !S_ISREG(st.st_mode)
+        || st.st_size < 0x10000 || st.st_size != (unsigned long)st.st_size)
+        return 0;
+    p = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+        return 0;
+    in_map = p;
+    in_map_size = st.st_size;
+    in_map_fd = fd;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static void unmap_input(NOOCState *s1)
+{
+#if CONFIG_NOOC_MMAP
+    if (in_map_kept) {
+        dynarray_add(&s1->input_maps, &s1->nb_input_maps, in_map);
+        dynarray_add(&s1->input_maps, &s1->nb_input_maps, (void *)in_map_size);
+    } else {
+        munmap(in_map, in_map_size);
+    }
+    in_map = NULL;
+    in_map_fd = -1;
+    in_map_kept = 0;
+#endif
+}
+
+/* after an error in the middle of a load: forget the mapping, whose fd
+   number may be used again */
+ST_FUNC void noocelf_end_input(NOOCState *s1)
+{
+    if (in_map)
+        unmap_input(s1);
+}
+
+/* the archive members from offset to end have been loaded: let their
+   pages go.  A page fault also maps the pages around it that are in the
+   page cache, so whole 64KB blocks are released.  The private pages are
+   reloaded from the file if used again. */
+static void release_input(unsigned long offset, unsigned long end)
+{
+#if CONFIG_NOOC_MMAP && defined MADV_DONTNEED
+    if (!in_map || in_map_kept)
+        return;
+    offset &= -0x10000ul;
+    end = (end + 0xffff) & -0x10000ul;
+    if (end > in_map_size)
+        end = in_map_size;
+    if (end > offset)
+        madvise(in_map + offset, end - offset, MADV_DONTNEED);
+#endif
+}
+
+/* like full_read() at file_offset */
+static ssize_t input_read(int fd, unsigned long file_offset, void *buf,
+                          unsigned long size)
+{
+    if (in_map && fd == in_map_fd) {
+        if (file_offset > in_map_size)
+            return 0;
+        if (size > in_map_size - file_offset)
+            size = in_map_size - file_offset;
+        memcpy(buf, in_map + file_offset, size);
+        return size;
+    }
+    lseek(fd, file_offset, SEEK_SET);
+    return full_read(fd, buf, size);
+}
+
+/* like load_data(), in place if the data is mapped and aligned */
+static void *input_data(int fd, unsigned long file_offset, unsigned long size)
+{
+    if (in_map && fd == in_map_fd && file_offset <= in_map_size
+        && size <= in_map_size - file_offset
+        && !((uintptr_t)(in_map + file_offset) & (sizeof(addr_t) - 1)))
+        return in_map + file_offset;
+    return load_data(fd, file_offset, size);
+}
+
+static void input_free(void *data)
+{
+    if (!in_map || (uint8_t *)data < in_map
+        || (uint8_t *)data > in_map + in_map_size)
+        nooc_free(data);
+}
+
 typedef struct SectionMergeInfo {
     Section *s;            /* corresponding existing section */
     unsigned long offset;  /* offset of the new section in the existing section */
@@ -2984,9 +3619,9 @@ typedef struct SectionMergeInfo {
     uint8_t link_once;         /* true if link once section */
 } SectionMergeInfo;
 
-ST_FUNC int nooc_object_type(int fd, ElfW(Ehdr) *h)
+/* the type of a file that starts with the 'size' bytes read into h */
+static int object_type(ElfW(Ehdr) *h, int size)
 {
-    int size = full_read(fd, h, sizeof *h);
     if (size == sizeof *h && 0 == memcmp(h, ELFMAG, 4)) {
         if (h->e_type == ET_REL)
             return AFF_BINTYPE_REL;
@@ -3003,10 +3638,14 @@ ST_FUNC int nooc_object_type(int fd, ElfW(Ehdr) *h)
     return 0;
 }
 
+ST_FUNC int nooc_object_type(int fd, ElfW(Ehdr) *h)
+{
+    return object_type(h, full_read(fd, h, sizeof *h));
+}
+
 /* load an object file and merge it with current files */
 /* XXX: handle correctly stab (debug) info */
-ST_FUNC int nooc_load_object_file(NOOCState *s1,
-                                int fd, unsigned long file_offset)
+static int load_object_file(NOOCState *s1, int fd, unsigned long file_offset)
 {
     ElfW(Ehdr) ehdr;
     ElfW(Shdr) *shdr, *sh;
@@ -3021,8 +3660,8 @@ ST_FUNC int nooc_load_object_file(NOOCState *s1,
     ElfW_Rel *rel;
     Section *s;
 
-    lseek(fd, file_offset, SEEK_SET);
-    if (nooc_object_type(fd, &ehdr) != AFF_BINTYPE_REL)
+    if (object_type(&ehdr, input_read(fd, file_offset, &ehdr, sizeof ehdr))
+        != AFF_BINTYPE_REL)
         goto invalid;
     /* test CPU specific stuff */
     if (ehdr.e_ident[5] != ELFDATA2LSB ||
@@ -3031,13 +3670,13 @@ invalid:
         return nooc_error_noabort("invalid object file");
     }
     /* read sections */
-    shdr = load_data(fd, file_offset + ehdr.e_shoff,
-                     sizeof(ElfW(Shdr)) * ehdr.e_shnum);
+    shdr = input_data(fd, file_offset + ehdr.e_shoff,
+                      sizeof(ElfW(Shdr)) * ehdr.e_shnum);
     sm_table = nooc_mallocz(sizeof(SectionMergeInfo) * ehdr.e_shnum);
 
     /* load section names */
     sh = &shdr[ehdr.e_shstrndx];
-    strsec = load_data(fd, file_offset + sh->sh_offset, sh->sh_size);
+    strsec = input_data(fd, file_offset + sh->sh_offset, sh->sh_size);
 
     /* load symtab and strtab */
     old_to_new_syms = NULL;
@@ -3056,12 +3695,12 @@ invalid:
                 goto the_end;
             }
             nb_syms = sh->sh_size / sizeof(ElfW(Sym));
-            symtab = load_data(fd, file_offset + sh->sh_offset, sh->sh_size);
+            symtab = input_data(fd, file_offset + sh->sh_offset, sh->sh_size);
             sm_table[i].s = symtab_section;
 
             /* now load strtab */
             sh = &shdr[sh->sh_link];
-            strtab = load_data(fd, file_offset + sh->sh_offset, sh->sh_size);
+            strtab = input_data(fd, file_offset + sh->sh_offset, sh->sh_size);
         }
 	if (sh->sh_flags & SHF_COMPRESSED)
 	    seencompressed = 1;
@@ -3147,9 +3786,18 @@ invalid:
         size = sh->sh_size;
         if (sh->sh_type != SHT_NOBITS) {
             unsigned char *ptr;
-            lseek(fd, file_offset + sh->sh_offset, SEEK_SET);
-            ptr = section_ptr_add(s, size);
-            full_read(fd, ptr, size);
+            offseti = file_offset + sh->sh_offset;
+            if (in_map && fd == in_map_fd && !s->data_allocated && size
+                && offseti <= in_map_size && size <= in_map_size - offseti
+                && !((uintptr_t)(in_map + offseti) & (sizeof(addr_t) - 1))) {
+                /* use the mapping, see above */
+                s->data = in_map + offseti;
+                s->data_allocated = s->data_offset = size;
+                s->data_mapped = in_map_kept = 1;
+            } else {
+                ptr = section_ptr_add(s, size);
+                input_read(fd, offseti, ptr, size);
+            }
         } else {
             s->data_offset += size;
         }
@@ -3285,12 +3933,23 @@ invalid:
 
     ret = 0;
  the_end:
-    nooc_free(symtab);
-    nooc_free(strtab);
+    input_free(symtab);
+    input_free(strtab);
     nooc_free(old_to_new_syms);
     nooc_free(sm_table);
-    nooc_free(strsec);
-    nooc_free(shdr);
+    input_free(strsec);
+    input_free(shdr);
+    return ret;
+}
+
+ST_FUNC int nooc_load_object_file(NOOCState *s1,
+                                int fd, unsigned long file_offset)
+{
+    int mapped = map_input(fd), ret;
+
+    ret = load_object_file(s1, fd, file_offset);
+    if (mapped)
+        unmap_input(s1);
     return ret;
 }
 
@@ -3318,8 +3977,7 @@ static int read_ar_header(int fd, int offset, ArchiveHeader *hdr)
 {
     char *p, *e;
     int len;
-    lseek(fd, offset, SEEK_SET);
-    len = full_read(fd, hdr, sizeof(ArchiveHeader));
+    len = input_read(fd, offset, hdr, sizeof(ArchiveHeader));
     if (len != sizeof(ArchiveHeader))
         return len ? -1 : 0;
     p = hdr->ar_name;
@@ -3330,61 +3988,92 @@ static int read_ar_header(int fd, int offset, ArchiveHeader *hdr)
     return len;
 }
 
-/* load only the objects which resolve undefined symbols */
-static int nooc_load_alacarte(NOOCState *s1, int fd, int size, int entrysize)
+/* load only the objects which resolve undefined symbols.  The names of
+   the archive index are hashed once; then each undefined symbol is
+   looked up once, and the loaded objects append the symbols they need
+   to symtab_section, so they are seen by the same pass. */
+static int nooc_load_alacarte(NOOCState *s1, int fd, unsigned long file_offset,
+                              int size, int entrysize)
 {
-    int i, bound, nsyms, sym_index, len, ret = -1;
-    unsigned long long off;
+    int i, h, mask, nsyms, sym_index, len, ret = -1;
+    int *hash = NULL;
+    unsigned long long off, *loaded = NULL;
     uint8_t *data;
-    const char *ar_names, *p;
+    const char *ar_names, *p, **names = NULL;
     const uint8_t *ar_index;
     ElfW(Sym) *sym;
     ArchiveHeader hdr;
 
     data = nooc_malloc(size);
-    if (full_read(fd, data, size) != size)
+    if (input_read(fd, file_offset, data, size) != size)
         goto the_end;
     nsyms = get_be(data, entrysize);
     ar_index = data + entrysize;
     ar_names = (char *) ar_index + nsyms * entrysize;
 
-    do {
-        bound = 0;
-        for (p = ar_names, i = 0; i < nsyms; i++, p += strlen(p)+1) {
-            Section *s = symtab_section;
-            sym_index = find_elf_sym(s, p);
-            if (!sym_index)
-                continue;
-            sym = &((ElfW(Sym) *)s->data)[sym_index];
-            if(sym->st_shndx != SHN_UNDEF)
-                continue;
-            off = get_be(ar_index + i * entrysize, entrysize);
-            len = read_ar_header(fd, off, &hdr);
-            if (len <= 0 || memcmp(hdr.ar_fmag, ARFMAG, 2)) {
-                nooc_error_noabort("invalid archive");
-                goto the_end;
-            }
-            off += len;
-            if (s1->verbose == 2)
-                printf("   -> %s\n", hdr.ar_name);
-            if (nooc_load_object_file(s1, fd, off) < 0)
-                goto the_end;
-            ++bound;
+    /* name -> first index entry, member offset -> loaded */
+    for (mask = 15; mask < 2 * nsyms; mask = mask * 2 + 1)
+        ;
+    hash = nooc_mallocz((mask + 1) * sizeof *hash);
+    loaded = nooc_mallocz((mask + 1) * sizeof *loaded);
+    names = nooc_malloc(nsyms * sizeof *names);
+    for (p = ar_names, i = 0; i < nsyms; i++, p += strlen(p)+1) {
+        names[i] = p;
+        for (h = elf_hash((unsigned char *) p) & mask; hash[h]; h = (h + 1) & mask)
+            if (!strcmp(names[hash[h] - 1], p))
+                break;
+        if (!hash[h])
+            hash[h] = i + 1;
+    }
+
+    for (sym_index = 1;
+         sym_index < symtab_section->data_offset / sizeof(ElfW(Sym));
+         sym_index++) {
+        sym = &((ElfW(Sym) *)symtab_section->data)[sym_index];
+        if (sym->st_shndx != SHN_UNDEF
+            || ELFW(ST_BIND)(sym->st_info) == STB_LOCAL)
+            continue;
+        p = (char *) symtab_section->link->data + sym->st_name;
+        for (h = elf_hash((unsigned char *) p) & mask; (i = hash[h]); h = (h + 1) & mask)
+            if (!strcmp(names[i - 1], p))
+                break;
+        if (!i)
+            continue;
+        off = get_be(ar_index + (i - 1) * entrysize, entrysize);
+        for (h = (off >> 1) & mask; loaded[h]; h = (h + 1) & mask)
+            if (loaded[h] == off)
+                break;
+        if (loaded[h])
+            continue;
+        loaded[h] = off;
+        len = read_ar_header(fd, off, &hdr);
+        if (len <= 0 || memcmp(hdr.ar_fmag, ARFMAG, 2)) {
+            nooc_error_noabort("invalid archive");
+            goto the_end;
         }
-    } while(bound);
+        off += len;
+        if (s1->verbose == 2)
+            printf("   -> %s\n", hdr.ar_name);
+        if (nooc_load_object_file(s1, fd, off) < 0)
+            goto the_end;
+        release_input(off, off + strtoul(hdr.ar_size, NULL, 0));
+    }
     ret = 0;
  the_end:
+    nooc_free(names);
+    nooc_free(loaded);
+    nooc_free(hash);
     nooc_free(data);
     return ret;
 }
 
 /* load a '.a' file */
-ST_FUNC int nooc_load_archive(NOOCState *s1, int fd, int alacarte)
+static int load_archive(NOOCState *s1, int fd, int alacarte)
 {
     ArchiveHeader hdr;
     /* char magic[8]; */
     int size, len;
-    unsigned long file_offset;
+    unsigned long file_offset, released = 0;
     ElfW(Ehdr) ehdr;
 
     /* skip magic which was already checked */
@@ -3404,19 +4093,35 @@ ST_FUNC int nooc_load_archive(NOOCState *s1, int fd, int alacarte)
         if (alacarte) {
             /* coff symbol table : we handle it */
             if (!strcmp(hdr.ar_name, "/"))
-                return nooc_load_alacarte(s1, fd, size, 4);
+                return nooc_load_alacarte(s1, fd, file_offset, size, 4);
             if (!strcmp(hdr.ar_name, "/SYM64/"))
-                return nooc_load_alacarte(s1, fd, size, 8);
-        } else if (nooc_object_type(fd, &ehdr) == AFF_BINTYPE_REL) {
+                return nooc_load_alacarte(s1, fd, file_offset, size, 8);
+        } else if (object_type(&ehdr, input_read(fd, file_offset, &ehdr, sizeof ehdr))
+                   == AFF_BINTYPE_REL) {
             if (s1->verbose == 2)
                 printf("   -> %s\n", hdr.ar_name);
             if (nooc_load_object_file(s1, fd, file_offset) < 0)
                 return -1;
+            /* the next members are likely in the same block */
+            if ((file_offset & -0x100000ul) > released) {
+                release_input(released, file_offset & -0x100000ul);
+                released = file_offset & -0x100000ul;
+            }
         }
         file_offset += size;
     }
 }
 
+ST_FUNC int nooc_load_archive(NOOCState *s1, int fd, int alacarte)
+{
+    int mapped = map_input(fd), ret;
+
+    ret = load_archive(s1, fd, alacarte);
+    if (mapped)
+        unmap_input(s1);
+    return ret;
+}
+
 #ifndef ELF_OBJ_ONLY
 /* Set LV[I] to the global index of sym-version (LIB,VERSION).  Maybe resizes
    LV, maybe create a new entry for (LIB,VERSION).  */
@@ -37,18 +37,18 @@ ST_DATA Sym *define_stack;
 ST_DATA Sym *global_label_stack;
 ST_DATA Sym *local_label_stack;
 
-static Sym *sym_free_first;
-static void **sym_pools;
-static int nb_sym_pools;
-
-static Sym *all_cleanups, *pending_gotos;
-static int local_scope;
-static int in_sizeof;
-static int constant_p;
+static ST_TLS Sym *sym_free_first;
+static ST_TLS void **sym_pools;
+static ST_TLS int nb_sym_pools;
+
+static ST_TLS Sym *all_cleanups, *pending_gotos;
+static ST_TLS int local_scope;
+static ST_TLS int in_sizeof;
+static ST_TLS int constant_p;
 ST_DATA char debug_modes;
 
 ST_DATA SValue *vtop;
-static SValue _vstack[1 + VSTACK_SIZE];
+static ST_TLS SValue _vstack[1 + VSTACK_SIZE];
 #define vstack (_vstack + 1)
 
 ST_DATA int nocode_wanted; /* no code generation wanted */
@@ -74,9 +74,13 @@ ST_DATA CType func_vt; /* current function return type (used by return instructi
 ST_DATA int func_var; /* true if current function is variadic (used by return instruction) */
 ST_DATA int func_vc;
 ST_DATA int func_ind;
+ST_DATA int func_regvars;
+ST_DATA int func_leaf;
+ST_DATA int label_ind;
+ST_DATA int no_constval;
 ST_DATA const char *funcname;
 ST_DATA CType int_type, func_old_type, char_type, char_pointer_type;
-static CString initstr;
+static ST_TLS CString initstr;
 
 #if PTR_SIZE == 4
 #define VT_SIZE_T (VT_INT | VT_UNSIGNED)
@@ -89,7 +93,7 @@ static CString initstr;
 #define VT_PTRDIFF_T (VT_LONG | VT_LLONG)
 #endif
 
-static struct switch_t {
+static ST_TLS struct switch_t {
     struct case_t {
         int64_t v1, v2;
 	int sym;
@@ -104,14 +108,14 @@ static struct switch_t {
 
 #define MAX_TEMP_LOCAL_VARIABLE_NUMBER 8
 /*list of temporary local variables on the stack in current function. */
-static struct temp_local_variable {
+static ST_TLS struct temp_local_variable {
 	int location; //offset on stack. Svalue.c.i
 	short size;
 	short align;
 } arr_temp_local_vars[MAX_TEMP_LOCAL_VARIABLE_NUMBER];
-static int nb_temp_local_vars;
+static ST_TLS int nb_temp_local_vars;
 
-static struct scope {
+static ST_TLS struct scope {
     struct scope *prev;
     struct { int loc, locorig, num; } vla;
     struct { Sym *s; int n; } cl;
@@ -119,10 +123,32 @@ static struct scope {
     Sym *lstk, *llstk;
 } *cur_scope, *loop_scope, *root_scope;
 
+/* -finline-functions: the calls being expanded, see gen_inline_call() */
+static ST_TLS struct inline_ctx {
+    int rsym; /* jumps from 'return' to the end of the body */
+    int ret; /* frame offset of the return value */
+    int level; /* local_scope of the outer block of the body */
+    struct scope *scope;
+    struct inline_ctx *prev;
+} *cur_inline;
+
+#ifdef NOOC_TARGET_TAIL_CALL
+/* -foptimize-sibling-calls: the place on the value stack of the
+   function of a call which may be the whole return expression */
+static ST_TLS SValue *tail_call_vtop;
+#endif
+
+#ifdef NOOC_TARGET_VECTORIZE
+/* -ftree-vectorize: the body was scanned by regvar_scan(), see vec_for() */
+static ST_TLS int func_vectorize;
+#endif
+
 typedef struct {
     Section *sec;
     int local_offset;
     Sym *flex_array_ref;
+    int cval_ok; /* last value stored was an integer constant 'cval' */
+    int64_t cval;
 } init_params;
 
 #if 1
@@ -152,10 +178,17 @@ static int gvtst(int inv, int t);
 static void gen_inline_functions(NOOCState *s);
 static void free_inline_functions(NOOCState *s);
 static void skip_or_save_block(TokenString **str);
+static int gen_inline_call(Sym *f);
 static void gv_dup(void);
 static int get_temp_local_var(int size,int align);
 static void clear_temp_local_var_list();
 static void cast_error(CType *st, CType *dt);
+#ifdef NOOC_TARGET_REGVARS
+static int regvar_ok(int v, CType *type);
+#endif
+#ifdef NOOC_TARGET_VECTORIZE
+static void vec_for(void);
+#endif
 
 /* ------------------------------------------------------------------------- */
 /* Automagical code suppression */
@@ -173,6 +206,7 @@ ST_FUNC void gsym(int t)
 static int gind()
 {
   int t = ind;
+  label_ind = t;
   CODE_ON();
   if (debug_modes)
     nooc_tcov_block_begin(nooc_state);
@@ -2285,6 +2319,182 @@ static int gen_opic_lt(uint64_t a, uint64_t b)
     return (a ^ (uint64_t)1 << 63) < (b ^ (uint64_t)1 << 63);
 }
 
+#ifdef NOOC_TARGET_MULH
+static void gen_opic(int op);
+
+/* magic numbers for the division by a constant 'd' (not 0, 1, -1 or a
+   power of 2) on 'n' bits, from Hacker's Delight 10-1 and 10-2.  They
+   return the shift, the multiplier is in '*m' */
+static int divc_magic_s(uint64_t d, int n, uint64_t *m)
+{
+    uint64_t msk = (uint64_t)-1 >> (64 - n), two = (uint64_t)1 << (n - 1);
+    uint64_t ad, anc, t, q1, r1, q2, r2, delta;
+    int p = n - 1;
+
+    d &= msk;
+    ad = d & two ? -d & msk : d;
+    t = two + !!(d & two);
+    anc = t - 1 - t % ad;
+    q1 = two / anc, r1 = two - q1 * anc;
+    q2 = two / ad, r2 = two - q2 * ad;
+    do {
+        ++p;
+        q1 = 2 * q1 & msk, r1 = 2 * r1 & msk;
+        if (r1 >= anc)
+            q1 = (q1 + 1) & msk, r1 -= anc;
+        q2 = 2 * q2 & msk, r2 = 2 * r2 & msk;
+        if (r2 >= ad)
+            q2 = (q2 + 1) & msk, r2 -= ad;
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    *m = (q2 + 1) & msk;
+    if (d & two)
+        *m = -*m & msk;
+    return p - n;
+}
+
+/* unsigned: if '*a' is set, the multiplier is 2^n + '*m' */
+static int divc_magic_u(uint64_t d, int n, uint64_t *m, int *a)
+{
+    uint64_t msk = (uint64_t)-1 >> (64 - n), two = (uint64_t)1 << (n - 1);
+    uint64_t nc, q1, r1, q2, r2, delta;
+    int p = n - 1;
+
+    *a = 0;
+    nc = msk - (-d & msk) % d;
+    q1 = two / nc, r1 = two - q1 * nc;
+    q2 = (two - 1) / d, r2 = (two - 1) - q2 * d;
+    do {
+        ++p;
+        if (r1 >= nc - r1)
+            q1 = (2 * q1 + 1) & msk, r1 = (2 * r1 - nc) & msk;
+        else
+            q1 = 2 * q1 & msk, r1 = 2 * r1 & msk;
+        if (r2 + 1 >= d - r2) {
+            if (q2 >= two - 1)
+                *a = 1;
+            q2 = (2 * q2 + 1) & msk, r2 = (2 * r2 + 1 - d) & msk;
+        } else {
+            if (q2 >= two)
+                *a = 1;
+            q2 = 2 * q2 & msk, r2 = (2 * r2 + 1) & msk;
+        }
+        delta = d - 1 - r2;
+    } while (p < 2 * n && (q1 < delta || (q1 == delta && r1 == 0)));
+    *m = (q2 + 1) & msk;
+    return p - n;
+}
+
+/* x / c and x % c (vtop is c, not 0, 1 or -1) with shifts for a power
+   of 2, and else with the high half of a multiplication by a magic
+   number followed by shifts.  The remainder is x - x / c * c. */
+static int gen_divc(int op, uint64_t c)
+{
+    int t = vtop[-1].type.t & (VT_BTYPE | VT_UNSIGNED);
+    int u = op == TOK_UDIV || op == TOK_UMOD;
+    int mod = op == '%' || op == TOK_UMOD;
+    int n, s, a, k;
+    uint64_t m, ad;
+
+    if ((t & VT_BTYPE) == VT_INT)
+        n = 32;
+    else if ((t & VT_BTYPE) == VT_LLONG)
+        n = 64;
+    else
+        return 0;
+    ad = u || !(c >> 63) ? c : -c;
+    if (n == 32)
+        ad = (uint32_t)ad;
+    for (k = 0; ad >> k != 1; ++k)
+        ;
+    if (u && !(ad & (ad - 1))) {
+        vtop->c.i = mod ? ad - 1 : k;
+        gen_opic(mod ? '&' : TOK_SHR);
+        return 1;
+    }
+    vpop();
+    if (mod)
+        gv_dup();
+
+    if (!(ad & (ad - 1))) {
+        /* add 2^k - 1 to a negative x */
+        gv_dup();
+        if (k > 1) {
+            vpushi(n - 1);
+            gen_opic(TOK_SAR);
+        }
+        vpushi(n - k);
+        gen_opic(TOK_SHR);
+        gen_opic('+');
+        if (mod) {
+            vpush64(t, -ad);
+            gen_opic('&');
+            gen_opic('-');
+            return 1;
+        }
+        vpushi(k);
+        gen_opic(TOK_SAR);
+        if (c >> 63) {
+            vpush64(t, 0);
+            vswap();
+            gen_opic('-');
+        }
+        return 1;
+    }
+
+    if (u) {
+        s = divc_magic_u(c, n, &m, &a);
+        if (a)
+            gv_dup();
+        vpush64(t, m);
+        gen_opic(TOK_UMULH);
+        if (a) {
+            /* (((x - h) >> 1) + h) >> (s - 1) */
+            gv_dup();
+            vrott(3);
+            gen_opic('-');
+            vpushi(1);
+            gen_opic(TOK_SHR);
+            gen_opic('+');
+            --s;
+        }
+        if (s) {
+            vpushi(s);
+            gen_opic(TOK_SHR);
+        }
+    } else {
+        s = divc_magic_s(c, n, &m);
+        if (n == 32)
+            m = (int32_t)m;
+        /* add or subtract x if the signs of m and c differ */
+        a = (m >> 63) != (c >> 63);
+        if (a)
+            gv_dup();
+        vpush64(t, m);
+        gen_opic(TOK_SMULH);
+        if (a) {
+            vswap();
+            gen_opic(c >> 63 ? '-' : '+');
+        }
+        if (s) {
+            vpushi(s);
+            gen_opic(TOK_SAR);
+        }
+        /* add 1 if negative */
+        gv_dup();
+        vpushi(n - 1);
+        gen_opic(TOK_SHR);
+        gen_opic('+');
+    }
+    if (mod) {
+        vpush64(t, c);
+        gen_opic('*');
+        gen_opic('-');
+    }
+    return 1;
+}
+#endif
+
 /* handle integer constant optimizations and various machine
    independent opt */
 static void gen_opic(int op)
@@ -2394,6 +2604,14 @@ static void gen_opic(int op)
                             (l2 == -1 || (l2 == 0xFFFFFFFF && t2 != VT_LLONG))))) {
             /* filter out NOP operations like x*1, x-0, x&-1... */
             vtop--;
+#ifdef NOOC_TARGET_MULH
+        } else if (c2 && (op == '/' || op == '%' || op == TOK_UDIV
+                          || op == TOK_UMOD || op == TOK_PDIV)
+                   && l2 != 0 && l2 != -1
+                   && (op != TOK_PDIV || (l2 & (l2 - 1)))
+                   && gen_divc(op == TOK_PDIV ? '/' : op, l2)) {
+            /* division by a constant without a division */
+#endif
         } else if (c2 && (op == '*' || op == TOK_PDIV || op == TOK_UDIV)) {
             /* try to use shifts instead of muls or divs */
             if (l2 > 0 && (l2 & (l2 - 1)) == 0) {
@@ -5433,6 +5651,101 @@ static void parse_atomic(int atok)
     }
 }
 
+/* the value of a const scalar variable with a constant initializer */
+static int64_t sym_constval(Sym *s)
+{
+    ElfSym *esym;
+    unsigned char *ptr;
+    int t = s->type.t;
+
+    if (!(s->r & VT_SYM))
+        return s->cval;
+    /* global: read it back from its section */
+    esym = elfsym(s);
+    ptr = nooc_state->sections[esym->st_shndx]->data + esym->st_value;
+    switch (t & VT_BTYPE) {
+    case VT_BOOL:
+        return *ptr;
+    case VT_BYTE:
+        return t & VT_UNSIGNED ? *ptr : (int64_t)(signed char)*ptr;
+    case VT_SHORT:
+        return t & VT_UNSIGNED ? read16le(ptr) : (int64_t)(int16_t)read16le(ptr);
+    case VT_INT:
+        return t & VT_UNSIGNED ? read32le(ptr) : (int64_t)(int32_t)read32le(ptr);
+    default:
+        return read64le(ptr);
+    }
+}
+
+#ifdef NOOC_TARGET_TAIL_CALL
+/* may the value of a function returning 'rt' be returned unchanged.
+   Structures need the caller's space, char and short are promoted
+   after calls, which a jump would skip, and so is the pop of an unused
+   long double. */
+static int tail_call_type(CType *rt)
+{
+    int bt = rt->t & VT_BTYPE;
+
+    if (bt == VT_STRUCT || bt == VT_BYTE || bt == VT_SHORT || bt == VT_BOOL)
+        return 0;
+    if ((func_vt.t & VT_BTYPE) == VT_VOID)
+        return bt != VT_LDOUBLE;
+    return (func_vt.t & VT_BTYPE) == bt;
+}
+#endif
+
+#ifdef NOOC_TARGET_INLINE_MEM
+/* expand a call to memcpy() or memset() with a small constant size in
+   place.  The stack is 'func dest src size' or 'func dest c size', and
+   is left with 'dest' of the type 'rt' */
+static int gen_mem_call(CType *rt)
+{
+    SValue *f = vtop - 3;
+    int c = -1, v;
+
+    if ((f->r & (VT_VALMASK | VT_SYM)) != (VT_CONST | VT_SYM) || f->c.i
+        || (f->sym->type.t & VT_STATIC)
+#ifdef CONFIG_NOOC_BCHECK
+        || nooc_state->do_bounds_check
+#endif
+        )
+        return 0;
+    v = f->sym->v;
+    if (v == TOK_memset) {
+        if ((vtop[-1].r & (VT_VALMASK | VT_LVAL | VT_SYM)) != VT_CONST)
+            return 0;
+        c = vtop[-1].c.i & 255;
+    } else if (v != TOK_memcpy) {
+        return 0;
+    }
+    if ((vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) != VT_CONST
+        || vtop->c.i > inline_mem_max(c))
+        return 0;
+
+    v = vtop->c.i;
+    vpop();
+    if (c >= 0) {
+        vpop();
+        if (vtop->r & VT_LVAL)
+            gv(RC_INT);
+        vdup();
+    } else {
+        vswap();
+        if (vtop->r & VT_LVAL)
+            gv(RC_INT);
+        /* func dest dest src */
+        vdup();
+        vrott(3);
+        vswap();
+    }
+    gen_inline_mem(c, v);
+    vtop->type = *rt;
+    vswap();
+    vpop();
+    return 1;
+}
+#endif
+
 ST_FUNC void unary(void)
 {
     int n, t, align, size, r, sizeof_caller;
@@ -5586,7 +5899,9 @@ ST_FUNC void unary(void)
         break;
     case '&':
         next();
+        ++no_constval;
         unary();
+        --no_constval;
         /* functions names must be treated as function pointers,
            except for unary '&' and sizeof. Since we consider that
            functions are not lvalues, we only have to handle it
@@ -5982,6 +6297,14 @@ special_math_val:
         } else if (r == VT_CONST && IS_ENUM_VAL(s->type.t)) {
             vtop->c.i = s->enum_val;
         }
+        if (s->a.constval && !s->a.weak && !CONST_WANTED
+                   && !no_constval && tok != '=' && !TOK_ASSIGN(tok)
+                   && tok != TOK_INC && tok != TOK_DEC) {
+            /* use the value of a const variable */
+            vtop->c.i = sym_constval(s);
+            vtop->r = VT_CONST;
+            vtop->sym = NULL;
+        }
         break;
     }
     
@@ -6042,6 +6365,10 @@ special_math_val:
                 }
             } else {
                 vtop->r &= ~VT_LVAL; /* no lvalue */
+                if ((vtop->r & (VT_VALMASK | VT_SYM)) == (VT_CONST | VT_SYM)
+                    && vtop->sym->a.inlinable && !vtop->c.i
+                    && !nocode_wanted && gen_inline_call(vtop->sym))
+                    continue;
             }
             /* get return type */
             s = vtop->type.ref;
@@ -6107,7 +6434,25 @@ special_math_val:
             if (sa)
                 nooc_error("too few arguments to function");
             skip(')');
+#ifdef NOOC_TARGET_INLINE_MEM
+            if (nb_args == 3 && gen_mem_call(&s->type))
+                continue;
+#endif
+#ifdef NOOC_TARGET_TAIL_CALL
+            if (vtop - nb_args == tail_call_vtop) {
+                /* the first call in the return expression */
+                tail_call_vtop = NULL;
+                if (tok == ';' && tail_call_type(&s->type)) {
+                    if (gfunc_tail_call(nb_args))
+                        CODE_OFF();
+                    goto call_done;
+                }
+            }
+#endif
             gfunc_call(nb_args);
+#ifdef NOOC_TARGET_TAIL_CALL
+        call_done:
+#endif
 
             if (ret_nregs < 0) {
                 vsetc(&ret.type, ret.r, &ret.c);
@@ -6314,7 +6659,7 @@ static int precedence(int tok)
 	    return 0;
     }
 }
-static unsigned char prec[256];
+static ST_TLS unsigned char prec[256];
 static void init_prec(void)
 {
     int i;
@@ -6748,6 +7093,60 @@ static void gcase(struct case_t **base, int len, int *bsym)
     *bsym = gjmp(*bsym);
 }
 
+#ifdef NOOC_TARGET_JUMP_TABLE
+/* dense switch: range check and indirect jump through a table.  Used
+   from JUMP_TABLE_MIN cases on, when at least 1 in JUMP_TABLE_RATIO
+   entries of the table is a case. */
+#define JUMP_TABLE_MIN 5
+#define JUMP_TABLE_RATIO 3
+
+static int gcase_table(struct switch_t *sw, int *bsym)
+{
+    struct case_t **base = sw->p, *p;
+    int len = sw->n, ll, i, *tab;
+    uint64_t span, v;
+
+    if (len < JUMP_TABLE_MIN)
+        return 0;
+    span = (uint64_t)base[len - 1]->v2 - base[0]->v1;
+    if (span >= (uint64_t)len * JUMP_TABLE_RATIO)
+        return 0;
+
+    /* (unsigned)(x - min) > span: default */
+    ll = (vtop->type.t & VT_BTYPE) == VT_LLONG;
+    vdup();
+    vtop->type.t |= VT_UNSIGNED;
+    if (ll)
+        vpushll(base[0]->v1);
+    else
+        vpushi(base[0]->v1);
+    gen_op('-');
+    vdup();
+    if (ll)
+        vpushll(span);
+    else
+        vpushi(span);
+    gen_op(TOK_GT);
+    *bsym = gvtst(0, *bsym);
+
+    /* holes go to 'default', or to the code after the table */
+    tab = nooc_malloc((span + 1) * sizeof *tab);
+    for (v = 0; v <= span; v++)
+        tab[v] = sw->def_sym ? sw->def_sym : -1;
+    for (i = 0; i < len; i++) {
+        p = base[i];
+        for (v = (uint64_t)p->v1 - base[0]->v1;
+             v <= (uint64_t)p->v2 - base[0]->v1; v++)
+            tab[v] = p->sym;
+    }
+    gen_jmp_table(tab, span + 1);
+    if (sw->def_sym)
+        CODE_OFF();
+    nooc_free(tab);
+    return 1;
+}
+#endif
+
 /* ------------------------------------------------------------------------- */
 /* __attribute__((cleanup(fn))) */
 
@@ -7010,7 +7409,21 @@ again:
     } else if (t == TOK_RETURN) {
         b = (func_vt.t & VT_BTYPE) != VT_VOID;
         if (tok != ';') {
+#ifdef NOOC_TARGET_TAIL_CALL
+            /* 'return f(...);' */
+            if (nooc_state->tail_calls && tok >= TOK_UIDENT && !cur_inline
+                && !cur_scope->cl.s && !nocode_wanted) {
+                t = tok;
+                next();
+                if (tok == '(')
+                    tail_call_vtop = vtop + 1;
+                unget_tok(t);
+            }
+            gexpr();
+            tail_call_vtop = NULL;
+#else
             gexpr();
+#endif
             if (b) {
                 gen_assign_cast(&func_vt);
             } else {
@@ -7022,12 +7435,28 @@ again:
             nooc_warning("'return' with no value");
             b = 0;
         }
-        leave_scope(root_scope);
-        if (b)
-            gfunc_return(&func_vt);
+        if (cur_inline) {
+            /* store the value for the end of the inlined body */
+            leave_scope(cur_inline->scope);
+            if (b) {
+                CType type = func_vt;
+                type.t &= ~(VT_CONSTANT | VT_VOLATILE);
+                vset(&type, VT_LOCAL | VT_LVAL, cur_inline->ret);
+                vswap();
+                vstore();
+                vpop();
+            }
+        } else {
+            leave_scope(root_scope);
+            if (b)
+                gfunc_return(&func_vt);
+        }
         skip(';');
         /* jump unless last stmt in top-level block */
-        if (tok != '}' || local_scope != 1)
+        if (cur_inline) {
+            if (tok != '}' || local_scope != cur_inline->level)
+                cur_inline->rsym = gjmp(cur_inline->rsym);
+        } else if (tok != '}' || local_scope != 1)
             rsym = gjmp(rsym);
         if (debug_modes)
 	    nooc_tcov_block_end (nooc_state, -1);
@@ -7065,6 +7494,10 @@ again:
             }
         }
         skip(';');
+#ifdef NOOC_TARGET_VECTORIZE
+        if (func_vectorize)
+            vec_for();
+#endif
         a = b = 0;
         c = d = gind();
         if (tok != ';') {
@@ -7139,7 +7572,11 @@ again:
                 nooc_error("duplicate case value");
         vpushv(&sw->sv);
         gv(RC_INT);
-        d = 0, gcase(sw->p, sw->n, &d);
+        d = 0;
+#ifdef NOOC_TARGET_JUMP_TABLE
+        if (!gcase_table(sw, &d))
+#endif
+            gcase(sw->p, sw->n, &d);
         vpop();
         if (sw->def_sym)
             gsym_addr(d, sw->def_sym);
@@ -7372,6 +7809,11 @@ static void init_putz(init_params *p, unsigned long c, int size)
     init_assert(p, c + size);
     if (p->sec) {
         /* nothing to do because globals are already set to zero */
+#ifdef NOOC_TARGET_INLINE_MEM
+    } else if (size <= inline_mem_max(0)) {
+        vseti(VT_LOCAL, c);
+        gen_inline_mem(0, size);
+#endif
     } else {
         vpush_helper_func(TOK_memset);
         vseti(VT_LOCAL, c);
@@ -7592,6 +8034,8 @@ static void init_putv(init_params *p, CType *type, unsigned long c)
 
         ptr = sec->data + c;
         val = vtop->c.i;
+        p->cval_ok = !(vtop->r & VT_SYM) && is_integer_btype(bt)
+            && !(type->t & VT_BITFIELD);
 
         /* XXX: make code faster ? */
 	if ((vtop->r & (VT_SYM|VT_CONST)) == (VT_SYM|VT_CONST) &&
@@ -7734,6 +8178,14 @@ static void init_putv(init_params *p, CType *type, unsigned long c)
 	}
         vtop--;
     } else {
+        p->cval_ok = 0;
+        if ((vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == VT_CONST
+            && is_integer_btype(type->t & VT_BTYPE)
+            && !(type->t & VT_BITFIELD)) {
+            gen_assign_cast(&dtype);
+            p->cval_ok = 1;
+            p->cval = vtop->c.i;
+        }
         vset(&dtype, VT_LOCAL|VT_LVAL, c);
         vswap();
         vstore();
@@ -7978,7 +8430,7 @@ static void decl_initializer_alloc(CType *type, AttributeDef *ad, int r,
 
     Section *sec;
     Sym *flexible_array;
-    Sym *sym;
+    Sym *sym = NULL;
     int saved_nocode_wanted = nocode_wanted;
 #ifdef CONFIG_NOOC_BCHECK
     int bcheck = nooc_state->do_bounds_check && !NODATA_WANTED;
@@ -8092,6 +8544,11 @@ static void decl_initializer_alloc(CType *type, AttributeDef *ad, int r,
 	    }
 #endif
             sym = sym_push(v, type, r, addr);
+#ifdef NOOC_TARGET_REGVARS
+            if (func_regvars && !ad->cleanup_func && !ad->asm_label
+                && !cur_inline && regvar_ok(v, type))
+                gen_regvar(addr, 0);
+#endif
 	    if (ad->cleanup_func) {
 		Sym *cls = sym_push2(&all_cleanups,
                     SYM_FIELD | ++cur_scope->cl.n, 0, 0);
@@ -8141,6 +8598,8 @@ static void decl_initializer_alloc(CType *type, AttributeDef *ad, int r,
                     nooc_warning("rw data: %s", get_tok_str(v, 0));*/
             } else if (nooc_state->nocommon)
                 sec = bss_section;
+            if (sec && v && nooc_state->data_sections)
+                sec = find_subsection(nooc_state, sec, get_tok_str(v, NULL));
         }
 
         if (sec) {
@@ -8217,6 +8676,15 @@ static void decl_initializer_alloc(CType *type, AttributeDef *ad, int r,
         /* for possible subsequent similar declarations */
         if (flexible_array)
             flexible_array->type.ref->c = -1;
+        /* a const integer with a constant value: see unary() */
+        if (v && p.cval_ok && is_integer_btype(type->t & VT_BTYPE)
+            && (type->t & (VT_CONSTANT | VT_VOLATILE)) == VT_CONSTANT
+            && (sec || (r & VT_VALMASK) == VT_LOCAL)
+            && (sec || p.cval == (intptr_t)p.cval)) {
+            if (!sec)
+                sym->cval = p.cval;
+            sym->a.constval = 1;
+        }
     }
 
  no_alloc:
@@ -8269,14 +8737,1181 @@ static void func_vla_arg(Sym *sym)
 	    func_vla_arg_code(arg);
 }
 
+#ifdef NOOC_TARGET_REGVARS
+/* -O1: weights of the identifiers in the body of the current function,
+   by token.  Each use counts 1, or 8 per enclosing loop.  Identifiers
+   that follow a unary '&' get -1 and are never kept in registers. */
+#define REGVAR_HASH_SIZE 1024
+#define REGVAR_MIN_WEIGHT 8
+
+static ST_TLS struct regvar_use { int v, w; } regvar_uses[REGVAR_HASH_SIZE];
+
+static struct regvar_use *regvar_use(int v, int add)
+{
+    struct regvar_use *u;
+    unsigned h = v;
+
+    for (;;) {
+        u = &regvar_uses[h++ & (REGVAR_HASH_SIZE - 1)];
+        if (u->v == v)
+            return u;
+        if (!u->v)
+            break;
+    }
+    if (!add || h - v > REGVAR_HASH_SIZE / 2)
+        return NULL;
+    u->v = v;
+    return u;
+}
+
+/* save the body of the function (tok is '{') to replay it after the
+   uses of its identifiers have been counted.  Returns the number of
+   registers that may be used, 0 with asm or setjmp in the body. */
+static int regvar_scan(TokenString **pstr)
+{
+    struct regvar_use *u;
+    struct { int t, level; } loops[32]; /* t: '(' header, '{' body, ';' statement */
+    int level = 0, paren = 0, nb_loops = 0, body = 0, head = 0, amp = 0;
+    int t, prev = 0, w, ok = 1, pack = -1;
+    const char *name;
+
+    memset(regvar_uses, 0, sizeof regvar_uses);
+    *pstr = tok_str_alloc();
+    for (;;) {
+        t = tok;
+        /* a #pragma pack in the body has already been seen by the
+           preprocessor, save its effect for the replay */
+        w = *nooc_state->pack_stack_ptr | nooc_state->ms_bitfields << 8;
+        if (w != pack) {
+            tok_str_add(*pstr, TOK_PACK);
+            tok_str_add(*pstr, pack = w);
+        }
+        tok_str_add_tok(*pstr);
+        if (body) {
+            /* loop body after 'for (...)', 'while (...)' or 'do' */
+            if (nb_loops < countof(loops)) {
+                loops[nb_loops].t = t == '{' ? '{' : ';';
+                loops[nb_loops++].level = level;
+            }
+            body = 0;
+        }
+        if (head && t == '(') {
+            if (nb_loops < countof(loops)) {
+                loops[nb_loops].t = '(';
+                loops[nb_loops++].level = paren;
+            }
+            head = 0;
+        }
+        w = 1 << 3 * (nb_loops < 4 ? nb_loops : 4);
+
+        if (t == '{') {
+            ++level;
+        } else if (t == '}') {
+            --level;
+            while (nb_loops && loops[nb_loops - 1].t != '('
+                   && loops[nb_loops - 1].level >= level
+                   && (loops[nb_loops - 1].t == ';'
+                       || loops[nb_loops - 1].level == level))
+                --nb_loops;
+        } else if (t == '(') {
+            ++paren;
+        } else if (t == ')') {
+            --paren;
+            if (nb_loops && loops[nb_loops - 1].t == '('
+                && loops[nb_loops - 1].level == paren)
+                --nb_loops, body = 1;
+        } else if (t == ';') {
+            while (nb_loops && loops[nb_loops - 1].t == ';'
+                   && loops[nb_loops - 1].level == level && !paren)
+                --nb_loops;
+        } else if (t == TOK_FOR || t == TOK_WHILE) {
+            head = 1;
+        } else if (t == TOK_DO) {
+            body = 1;
+        } else if (t == TOK_ASM1 || t == TOK_ASM2 || t == TOK_ASM3) {
+            ok = 0;
+        } else if (t >= TOK_UIDENT) {
+            name = get_tok_str(t, NULL);
+            if (strstr(name, "setjmp") || !strcmp(name, "vfork"))
+                ok = 0;
+            u = regvar_use(t, 1);
+            if (u && u->w >= 0)
+                u->w = amp ? -1 : u->w + w;
+        }
+
+        /* '&x', '&(x)', but not 'a & x' */
+        if (t == '&')
+            amp = !(prev >= TOK_UIDENT
+                    || (prev >= TOK_CCHAR && prev <= TOK_PPNUM)
+                    || prev == ']' || prev == TOK_INC || prev == TOK_DEC);
+        else if (t != '(')
+            amp = 0;
+
+        if (level == 0)
+            break;
+        prev = t;
+        next();
+    }
+    tok_str_add(*pstr, -1);
+    tok_str_add(*pstr, 0);
+    return ok ? NOOC_TARGET_REGVARS : 0;
+}
+
+/* may the local 'v' of type 'type' live in a register */
+static int regvar_ok(int v, CType *type)
+{
+    struct regvar_use *u;
+    int bt = type->t & VT_BTYPE;
+
+    if (bt != VT_BYTE && bt != VT_SHORT && bt != VT_INT && bt != VT_LLONG
+        && bt != VT_PTR && bt != VT_BOOL)
+        return 0;
+    if (type->t & (VT_ARRAY | VT_VLA | VT_VOLATILE | VT_BITFIELD))
+        return 0;
+    u = regvar_use(v, 0);
+    return u && u->w >= REGVAR_MIN_WEIGHT;
+}
+
+/* parameters pushed by gfunc_prolog() */
+static void regvar_params(Sym *sym)
+{
+    Sym *s;
+
+    for (sym = sym->type.ref->next; sym; sym = sym->next) {
+        s = sym_find(sym->v & ~SYM_FIELD);
+        if (s && (s->r & (VT_VALMASK | VT_LVAL)) == (VT_LOCAL | VT_LVAL)
+            && regvar_ok(s->v, &s->type))
+            gen_regvar(s->c, 1);
+    }
+}
+#endif
+
+#ifdef NOOC_TARGET_VECTORIZE
+/* -ftree-vectorize: a loop like
+
+       for (...; i < n; i++)
+           d[i] = a[i] * k + b[i];
+
+   is run on vectors of gen_vec_size() bytes as long as there are
+   enough elements left, and then by the normal code for the rest.
+   vec_for() reads the header and the body as an expression tree,
+   keeping the tokens to compile the loop as written afterwards.
+   Locals must not have their address taken (see regvar_scan()), the
+   index and the bound are ints or longs, the arrays are indexed by 'i'
+   only and all have elements of the same size.  The body is one of
+
+       d[i] = e;  d[i] op= e;   stores
+       s += e;  s -= e;         sums of int or long long lanes
+       if (e) break;            searches
+
+   with +, -, *, &, |, ^, comparisons, &&, || and ?: on the arrays,
+   locals and constants.  Stores check at run time that d does not
+   overlap another array a few elements below it (restrict is not
+   kept in the types). */
+#define VEC_MAX_NODES 48
+#define VEC_MAX_ARRAYS 4
+#define VEC_MAX_INVS 8 /* xmm15 down */
+#define VEC_MAX_TEMPS 8 /* xmm0 up */
+
+struct vec_node {
+    int op; /* 0 for a leaf */
+    int t; /* type, VT_BTYPE | VT_UNSIGNED */
+    int x; /* leaf: array, or -1 - invariant */
+    int l, r, c; /* operands, c: condition of '?' */
+    int vop, neg, swap; /* VEC_xxx, then invert the result, operands swapped */
+    int mask; /* a comparison: all ones or zero in each lane */
+    int minus; /* unary minus */
+};
+
+struct vec_loop {
+    TokenString *str; /* the tokens read */
+    Sym *i, *n, *s; /* index, bound (NULL if constant), sum */
+    CValue nc;
+    int nt, ct; /* type of the bound, of the comparison */
+    int kind; /* '=', TOK_A_ADD, TOK_A_SUB or TOK_BREAK */
+    int root, dst, lane;
+    int ones, acc; /* registers of all ones, of the sum */
+    int uncond; /* arrays read in every iteration */
+    struct vec_node node[VEC_MAX_NODES];
+    int nb_nodes;
+    Sym *array[VEC_MAX_ARRAYS];
+    int nb_arrays;
+    struct { Sym *sym; int t; CValue c; } inv[VEC_MAX_INVS];
+    int nb_invs;
+};
+
+#define VEC_T(t) ((t) & (VT_BTYPE | VT_UNSIGNED))
+#define VEC_INV_REG(k) (15 - (k))
+
+static int vec_size(int bt)
+{
+    return bt == VT_FLOAT ? 4 : bt == VT_DOUBLE ? 8 : btype_size(bt);
+}
+
+static void vec_next(struct vec_loop *vl)
+{
+    tok_str_add_tok(vl->str);
+    next();
+}
+
+static int vec_skip(struct vec_loop *vl, int t)
+{
+    if (tok != t)
+        return 0;
+    vec_next(vl);
+    return 1;
+}
+
+/* a local whose address is never taken */
+static int vec_local(Sym *s)
+{
+    struct regvar_use *u;
+
+    return s && (s->r & (VT_VALMASK | VT_LVAL)) == (VT_LOCAL | VT_LVAL)
+        && !(s->type.t & (VT_ARRAY | VT_VLA | VT_VOLATILE | VT_BITFIELD))
+        && (u = regvar_use(s->v, 0)) && u->w >= 0;
+}
+
+static int vec_scalar(int t)
+{
+    int bt = t & VT_BTYPE;
+
+    return !(t & (VT_ARRAY | VT_VLA | VT_VOLATILE | VT_BITFIELD))
+        && (bt == VT_BYTE || bt == VT_SHORT || bt == VT_INT
+            || bt == VT_LLONG || bt == VT_FLOAT || bt == VT_DOUBLE);
+}
+
+/* the usual arithmetic conversions */
+static int vec_conv(int a, int b)
+{
+    int sa, sb;
+
+    if (is_float(a) || is_float(b))
+        return (a & VT_BTYPE) == VT_DOUBLE || (b & VT_BTYPE) == VT_DOUBLE
+            ? VT_DOUBLE : VT_FLOAT;
+    sa = btype_size(a & VT_BTYPE), sb = btype_size(b & VT_BTYPE);
+    if (sa < 4)
+        a = VT_INT, sa = 4;
+    if (sb < 4)
+        b = VT_INT, sb = 4;
+    if (sa != sb)
+        return sa > sb ? a : b;
+    return a | (b & VT_UNSIGNED);
+}
+
+static int vec_node(struct vec_loop *vl, int op, int l, int r)
+{
+    struct vec_node *p;
+
+    if (l < 0 || r < 0 || vl->nb_nodes == VEC_MAX_NODES)
+        return -1;
+    p = &vl->node[vl->nb_nodes];
+    memset(p, 0, sizeof *p);
+    p->op = op, p->l = l, p->r = r, p->c = -1;
+    return vl->nb_nodes++;
+}
+
+static int vec_leaf(struct vec_loop *vl, int x, int t)
+{
+    int n;
+
+    for (n = 0; n < vl->nb_nodes; ++n)
+        if (!vl->node[n].op && vl->node[n].x == x)
+            return n;
+    n = vec_node(vl, 0, 0, 0);
+    if (n >= 0)
+        vl->node[n].x = x, vl->node[n].t = t;
+    return n;
+}
+
+/* a local or a constant, the same in every iteration */
+static int vec_inv(struct vec_loop *vl, Sym *s, int t, CValue *c)
+{
+    int k;
+
+    for (k = 0; k < vl->nb_invs; ++k)
+        if (s ? vl->inv[k].sym == s
+            : !vl->inv[k].sym && vl->inv[k].t == t && vl->inv[k].c.i == c->i)
+            break;
+    if (k == vl->nb_invs) {
+        if (k == VEC_MAX_INVS)
+            return -1;
+        vl->inv[k].sym = s;
+        vl->inv[k].t = t;
+        if (c)
+            vl->inv[k].c = *c;
+        vl->nb_invs++;
+    }
+    return vec_leaf(vl, -1 - k, t);
+}
+
+static int vec_const(struct vec_loop *vl, int t, int64_t v)
+{
+    CValue c;
+
+    memset(&c, 0, sizeof c);
+    c.i = (t & VT_BTYPE) == VT_LLONG ? v
+        : t & VT_UNSIGNED ? (uint32_t)v : (uint64_t)(int)v;
+    return vec_inv(vl, NULL, t, &c);
+}
+
+/* a number, negated if 'minus' */
+static int vec_number(struct vec_loop *vl, int minus)
+{
+    CValue c;
+    int t;
+
+    memset(&c, 0, sizeof c);
+    switch (tok) {
+    case TOK_CCHAR: case TOK_LCHAR: case TOK_CINT:
+        t = VT_INT;
+        break;
+    case TOK_CUINT:
+        t = VT_INT | VT_UNSIGNED;
+        break;
+    case TOK_CLLONG: case TOK_CLONG:
+        t = VT_LLONG;
+        break;
+    case TOK_CULLONG: case TOK_CULONG:
+        t = VT_LLONG | VT_UNSIGNED;
+        break;
+    case TOK_CFLOAT:
+        c.f = minus ? -tokc.f : tokc.f;
+        vec_next(vl);
+        return vec_inv(vl, NULL, VT_FLOAT, &c);
+    case TOK_CDOUBLE:
+        c.d = minus ? -tokc.d : tokc.d;
+        vec_next(vl);
+        return vec_inv(vl, NULL, VT_DOUBLE, &c);
+    default:
+        return -1;
+    }
+    c.i = minus ? -tokc.i : tokc.i;
+    vec_next(vl);
+    return vec_const(vl, t, c.i);
+}
+
+/* 's[i]' */
+static int vec_array(struct vec_loop *vl, Sym *s)
+{
+    int k, t;
+
+    if (!s)
+        return -1;
+    if (s->type.t & VT_ARRAY) {
+        if ((s->type.t & VT_VLA)
+            || ((s->r & VT_VALMASK) != VT_LOCAL
+                && (s->r & (VT_VALMASK | VT_SYM)) != (VT_CONST | VT_SYM)))
+            return -1;
+    } else if (!vec_local(s) || (s->type.t & VT_BTYPE) != VT_PTR) {
+        return -1;
+    }
+    t = pointed_type(&s->type)->t;
+    if (!vec_scalar(t))
+        return -1;
+    for (k = 0; k < vl->nb_arrays; ++k)
+        if (vl->array[k] == s)
+            break;
+    if (k == vl->nb_arrays) {
+        if (k == VEC_MAX_ARRAYS)
+            return -1;
+        vl->array[vl->nb_arrays++] = s;
+    }
+    return vec_leaf(vl, k, VEC_T(t));
+}
+
+static int vec_var(struct vec_loop *vl, Sym *s)
+{
+    if (!s)
+        return -1;
+    if (s->r == VT_CONST && IS_ENUM_VAL(s->type.t))
+        return vec_const(vl, VEC_T(s->type.t), s->enum_val);
+    if (!vec_local(s) || s == vl->i || s == vl->s || !vec_scalar(s->type.t))
+        return -1;
+    return vec_inv(vl, s, VEC_T(s->type.t), NULL);
+}
+
+static int vec_cond(struct vec_loop *vl);
+
+static int vec_unary(struct vec_loop *vl)
+{
+    Sym *s;
+    int n;
+
+    if (tok == '(') {
+        vec_next(vl);
+        n = vec_cond(vl);
+        return n >= 0 && vec_skip(vl, ')') ? n : -1;
+    }
+    if (tok == '-') {
+        vec_next(vl);
+        n = vec_number(vl, 1);
+        if (n >= 0)
+            return n;
+        n = vec_node(vl, '-', vec_const(vl, VT_INT, 0), vec_unary(vl));
+        if (n >= 0)
+            vl->node[n].minus = 1;
+        return n;
+    }
+    if (tok < TOK_UIDENT)
+        return vec_number(vl, 0);
+    s = sym_find(tok);
+    vec_next(vl);
+    if (tok != '[')
+        return vec_var(vl, s);
+    vec_next(vl);
+    if (tok != vl->i->v)
+        return -1;
+    vec_next(vl);
+    return vec_skip(vl, ']') ? vec_array(vl, s) : -1;
+}
+
+static int vec_prec(int t)
+{
+    switch (t) {
+    case TOK_LOR: return 1;
+    case TOK_LAND: return 2;
+    case '|': return 3;
+    case '^': return 4;
+    case '&': return 5;
+    case TOK_EQ: case TOK_NE: return 6;
+    case TOK_LT: case TOK_GT: case TOK_LE: case TOK_GE: return 7;
+    case '+': case '-': return 9;
+    case '*': return 10;
+    }
+    return 0;
+}
+
+static int vec_expr(struct vec_loop *vl, int prec)
+{
+    int l = vec_unary(vl), p, op;
+
+    while (l >= 0 && (p = vec_prec(tok)) >= prec) {
+        op = tok;
+        vec_next(vl);
+        l = vec_node(vl, op, l, vec_expr(vl, p + 1));
+    }
+    return l;
+}
+
+static int vec_cond(struct vec_loop *vl)
+{
+    int c = vec_expr(vl, 1), a, n;
+
+    if (c < 0 || tok != '?')
+        return c;
+    vec_next(vl);
+    a = vec_cond(vl);
+    if (a < 0 || !vec_skip(vl, ':'))
+        return -1;
+    n = vec_node(vl, '?', a, vec_cond(vl));
+    if (n >= 0)
+        vl->node[n].c = c;
+    return n;
+}
+
+static int vec_constant(struct vec_loop *vl, struct vec_node *p)
+{
+    return !p->op && p->x < 0 && !vl->inv[-1 - p->x].sym;
+}
+
+/* 'a' compared on lanes of 'size' < 4 bytes with 'b', both promoted to
+   int: it must be a value of the lane type */
+static int vec_narrow(struct vec_loop *vl, struct vec_node *a,
+                      struct vec_node *b, int size)
+{
+    int64_t v, m = (int64_t)1 << 8 * size;
+
+    if (a->op)
+        return 0;
+    if (!vec_constant(vl, a))
+        return btype_size(a->t & VT_BTYPE) == size
+            && (vec_constant(vl, b) || !((a->t ^ b->t) & VT_UNSIGNED));
+    if (b->op || vec_constant(vl, b))
+        return 0;
+    v = vl->inv[-1 - a->x].c.i;
+    return b->t & VT_UNSIGNED ? v >= 0 && v < m : v >= -m / 2 && v < m / 2;
+}
+
+/* find how to do the comparison p */
+static int vec_cmp(struct vec_loop *vl, struct vec_node *p)
+{
+    struct vec_node *l = &vl->node[p->l], *r = &vl->node[p->r];
+    int size = btype_size(vl->lane), op = p->op, o, v, uns;
+
+    if (is_float(vl->lane)) {
+        if (p->t != vl->lane)
+            return 0;
+    } else {
+        if (size < 4) {
+            if (!vec_narrow(vl, l, r, size) || !vec_narrow(vl, r, l, size))
+                return 0;
+            uns = (vec_constant(vl, l) ? r->t : l->t) & VT_UNSIGNED;
+        } else {
+            if (btype_size(p->t & VT_BTYPE) > size)
+                return 0;
+            uns = p->t & VT_UNSIGNED;
+        }
+        /* the lanes are compared signed */
+        if (uns && op != TOK_EQ && op != TOK_NE)
+            return 0;
+    }
+    for (v = 0; v < 4; ++v) {
+        o = op;
+        if (v & 1)
+            o = o == TOK_LT ? TOK_GT : o == TOK_GT ? TOK_LT
+                : o == TOK_LE ? TOK_GE : o == TOK_GE ? TOK_LE : o;
+        /* !(a < b) is not a >= b with NaNs, but floats need no 'neg' */
+        if (v & 2)
+            o = o == TOK_EQ ? TOK_NE : o == TOK_NE ? TOK_EQ
+                : o == TOK_LT ? TOK_GE : o == TOK_GE ? TOK_LT
+                : o == TOK_LE ? TOK_GT : TOK_LE;
+        p->vop = o == TOK_EQ ? VEC_CMPEQ : o == TOK_NE ? VEC_CMPNE
+            : o == TOK_LT ? VEC_CMPLT : o == TOK_LE ? VEC_CMPLE
+            : o == TOK_GT ? VEC_CMPGT : -1;
+        if (p->vop >= 0 && gen_vec_ok(p->vop, vl->lane)) {
+            p->swap = v & 1;
+            p->neg = v >> 1;
+            vl->ones |= p->neg;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* can node n be computed on the lanes */
+static int vec_check(struct vec_loop *vl, int n)
+{
+    struct vec_node *p = &vl->node[n], *l, *r;
+    int fp = is_float(vl->lane), t;
+
+    if (!p->op) {
+        if (p->x >= 0)
+            return 1;
+        /* splat to the lane type */
+        return fp ? (p->t & VT_BTYPE) != VT_DOUBLE || vl->lane == VT_DOUBLE
+            : !is_float(p->t);
+    }
+    if (p->op == '?' && (!vec_check(vl, p->c) || !vl->node[p->c].mask))
+        return 0;
+    if (!vec_check(vl, p->l) || !vec_check(vl, p->r))
+        return 0;
+    l = &vl->node[p->l], r = &vl->node[p->r];
+    if (p->op == TOK_LAND || p->op == TOK_LOR) {
+        p->vop = p->op == TOK_LAND ? VEC_AND : VEC_OR;
+        p->mask = 1;
+        return l->mask && r->mask;
+    }
+    if (l->mask || r->mask)
+        return 0;
+    t = p->t = vec_conv(l->t, r->t);
+    switch (p->op) {
+    case TOK_EQ: case TOK_NE: case TOK_LT: case TOK_GT: case TOK_LE: case TOK_GE:
+        p->mask = 1;
+        return vec_cmp(vl, p);
+    case '?':
+        p->vop = VEC_ANDN;
+        break;
+    case '+': p->vop = VEC_ADD; break;
+    case '*': p->vop = VEC_MUL; break;
+    case '&': p->vop = VEC_AND; break;
+    case '|': p->vop = VEC_OR; break;
+    case '^': p->vop = VEC_XOR; break;
+    case '-':
+        /* -0.0 */
+        if (fp && p->minus)
+            return 0;
+        p->vop = VEC_SUB;
+        break;
+    }
+    if (fp ? t != vl->lane || p->vop == VEC_AND || p->vop == VEC_OR
+        || p->vop == VEC_XOR : is_float(t))
+        return 0;
+    /* the high half of the lanes would be sign extended */
+    if (vl->lane == VT_LLONG && btype_size(t & VT_BTYPE) == 4
+        && (t & VT_UNSIGNED))
+        return 0;
+    return gen_vec_ok(p->vop, vl->lane);
+}
+
+/* set vl->uncond for the arrays read whatever the values are */
+static void vec_reads(struct vec_loop *vl, int n, int cond)
+{
+    struct vec_node *p = &vl->node[n];
+
+    if (!p->op) {
+        if (p->x >= 0 && !cond)
+            vl->uncond |= 1 << p->x;
+        return;
+    }
+    if (p->op == '?') {
+        vec_reads(vl, p->c, cond);
+        cond = 1;
+    }
+    vec_reads(vl, p->l, cond);
+    vec_reads(vl, p->r, cond || p->op == TOK_LAND || p->op == TOK_LOR);
+}
+
+/* an array object with at least as many elements as the loop runs */
+static int vec_fixed(struct vec_loop *vl, int k)
+{
+    Sym *s = vl->array[k];
+
+    return (s->type.t & VT_ARRAY) && !vl->n && s->type.ref->c >= 0
+        && (vl->ct & VT_UNSIGNED ? vl->nc.i : (int64_t)vl->nc.i)
+           <= s->type.ref->c;
+}
+
+/* vector registers needed to compute node n, in place if 'operand' */
+static int vec_need(struct vec_loop *vl, int n, int operand)
+{
+    struct vec_node *p = &vl->node[n];
+    int a, b;
+
+    if (!p->op)
+        return operand && p->x < 0 ? 0 : 1;
+    if (p->op == '?') {
+        a = vec_need(vl, p->c, 0);
+        b = 1 + vec_need(vl, p->l, 0);
+        a = a > b ? a : b;
+        b = 2 + vec_need(vl, p->r, 1);
+    } else {
+        a = vec_need(vl, p->swap ? p->r : p->l, 0);
+        b = 1 + vec_need(vl, p->swap ? p->l : p->r, 1);
+    }
+    return a > b ? a : b;
+}
+
+/* 'i < n; i++)' and the body */
+static int vec_parse(struct vec_loop *vl)
+{
+    Sym *s;
+    int t, op;
+
+    if (tok < TOK_UIDENT)
+        return 0;
+    s = vl->i = sym_find(tok);
+    if (!vec_local(s) || ((s->type.t & VT_BTYPE) != VT_INT
+                          && (s->type.t & VT_BTYPE) != VT_LLONG))
+        return 0;
+    vec_next(vl);
+    if (!vec_skip(vl, TOK_LT))
+        return 0;
+    if (tok >= TOK_UIDENT) {
+        s = vl->n = sym_find(tok);
+        if (!vec_local(s) || s == vl->i || is_float(s->type.t)
+            || !vec_scalar(s->type.t))
+            return 0;
+        vl->nt = VEC_T(s->type.t);
+    } else {
+        switch (tok) {
+        case TOK_CINT: vl->nt = VT_INT; break;
+        case TOK_CUINT: vl->nt = VT_INT | VT_UNSIGNED; break;
+        case TOK_CLLONG: case TOK_CLONG: vl->nt = VT_LLONG; break;
+        case TOK_CULLONG: case TOK_CULONG:
+            vl->nt = VT_LLONG | VT_UNSIGNED;
+            break;
+        default:
+            return 0;
+        }
+        vl->nc = tokc;
+    }
+    vec_next(vl);
+    /* i must be extended to 64 bits like the comparison wants */
+    vl->ct = vec_conv(VEC_T(vl->i->type.t), vl->nt);
+    if ((vl->ct & VT_UNSIGNED) && !(vl->i->type.t & VT_UNSIGNED))
+        return 0;
+    if (!vec_skip(vl, ';'))
+        return 0;
+
+    if (tok == TOK_INC) {
+        vec_next(vl);
+        if (!vec_skip(vl, vl->i->v))
+            return 0;
+    } else {
+        if (!vec_skip(vl, vl->i->v))
+            return 0;
+        if (vec_skip(vl, TOK_A_ADD)) {
+            if (tok != TOK_CINT || tokc.i != 1)
+                return 0;
+            vec_next(vl);
+        } else if (!vec_skip(vl, TOK_INC)) {
+            return 0;
+        }
+    }
+    if (!vec_skip(vl, ')'))
+        return 0;
+
+    t = vec_skip(vl, '{');
+    if (vec_skip(vl, TOK_IF)) {
+        if (!vec_skip(vl, '('))
+            return 0;
+        vl->root = vec_cond(vl);
+        if (vl->root < 0 || !vec_skip(vl, ')') || !vec_skip(vl, TOK_BREAK)
+            || !vec_skip(vl, ';') || tok == TOK_ELSE)
+            return 0;
+        vl->kind = TOK_BREAK;
+    } else {
+        if (tok < TOK_UIDENT)
+            return 0;
+        s = sym_find(tok);
+        vec_next(vl);
+        if (tok == '[') {
+            vec_next(vl);
+            if (!vec_skip(vl, vl->i->v) || !vec_skip(vl, ']'))
+                return 0;
+            vl->dst = vec_array(vl, s);
+            op = tok == '=' ? 0 : tok == TOK_A_ADD ? '+' : tok == TOK_A_SUB ? '-'
+                : tok == TOK_A_MUL ? '*' : tok == TOK_A_AND ? '&'
+                : tok == TOK_A_OR ? '|' : tok == TOK_A_XOR ? '^' : -1;
+            if (vl->dst < 0 || op < 0)
+                return 0;
+            vec_next(vl);
+            vl->root = vec_cond(vl);
+            if (op)
+                vl->root = vec_node(vl, op, vl->dst, vl->root);
+            vl->dst = vl->node[vl->dst].x;
+            vl->kind = '=';
+        } else {
+            if (!vec_local(s) || s == vl->i || s == vl->n
+                || ((s->type.t & VT_BTYPE) != VT_INT
+                    && (s->type.t & VT_BTYPE) != VT_LLONG)
+                || (tok != TOK_A_ADD && tok != TOK_A_SUB))
+                return 0;
+            vl->s = s;
+            vl->kind = tok;
+            vec_next(vl);
+            vl->root = vec_cond(vl);
+        }
+        if (vl->root < 0 || !vec_skip(vl, ';'))
+            return 0;
+    }
+    return !t || tok == '}';
+}
+
+/* types, registers and memory accesses of the loop */
+static int vec_prepare(struct vec_loop *vl)
+{
+    struct vec_node *p;
+    int k;
+
+    if (!vl->nb_arrays)
+        return 0;
+    vl->lane = pointed_type(&vl->array[vl->kind == '=' ? vl->dst : 0]->type)->t
+        & VT_BTYPE;
+    for (k = 0; k < vl->nb_arrays; ++k)
+        if ((pointed_type(&vl->array[k]->type)->t & VT_BTYPE) != vl->lane)
+            return 0;
+    if (!vec_check(vl, vl->root))
+        return 0;
+    p = &vl->node[vl->root];
+    if (vl->kind == TOK_BREAK ? !p->mask : p->mask)
+        return 0;
+    if (vl->kind == TOK_A_ADD || vl->kind == TOK_A_SUB) {
+        if ((vl->lane != VT_INT && vl->lane != VT_LLONG)
+            || btype_size(vl->s->type.t & VT_BTYPE) != btype_size(vl->lane))
+            return 0;
+        vl->acc = 1;
+    }
+    /* what the loop as written reads only in some iterations may not
+       be there */
+    vec_reads(vl, vl->root, 0);
+    for (k = 0; k < vl->nb_arrays; ++k)
+        if (!(vl->uncond & 1 << k) && !(vl->kind == '=' && k == vl->dst)
+            && !vec_fixed(vl, k))
+            return 0;
+    if (vl->nb_invs + vl->ones + vl->acc > VEC_MAX_INVS
+        || vec_need(vl, vl->root, 0) > VEC_MAX_TEMPS)
+        return 0;
+    return 1;
+}
+
+static void vec_push_sym(Sym *s)
+{
+    vset(&s->type, s->r, s->c);
+    vtop->sym = s;
+    if (s->r & VT_SYM)
+        vtop->c.i = 0;
+}
+
+/* compute node n into the vector register x and return x, or the
+   register of an invariant if 'operand' */
+static int vec_eval(struct vec_loop *vl, int n, int x, int operand,
+                    int *base, int ri)
+{
+    struct vec_node *p = &vl->node[n];
+    int l, r;
+
+    if (!p->op) {
+        if (p->x >= 0) {
+            gen_vec_mem(0, x, base[p->x], ri, vec_size(vl->lane));
+            return x;
+        }
+        if (operand)
+            return VEC_INV_REG(-1 - p->x);
+        gen_vec_op(VEC_MOV, vl->lane, x, VEC_INV_REG(-1 - p->x));
+        return x;
+    }
+    if (p->op == '?') {
+        /* (l & c) | (~c & r) */
+        vec_eval(vl, p->c, x, 0, base, ri);
+        vec_eval(vl, p->l, x + 1, 0, base, ri);
+        gen_vec_op(VEC_AND, vl->lane, x + 1, x);
+        gen_vec_op(VEC_ANDN, vl->lane, x,
+                   vec_eval(vl, p->r, x + 2, 1, base, ri));
+        gen_vec_op(VEC_OR, vl->lane, x, x + 1);
+        return x;
+    }
+    l = p->swap ? p->r : p->l, r = p->swap ? p->l : p->r;
+    vec_eval(vl, l, x, 0, base, ri);
+    gen_vec_op(p->vop, vl->lane, x, vec_eval(vl, r, x + 1, 1, base, ri));
+    if (p->neg)
+        gen_vec_op(VEC_XOR, vl->lane, x, vl->ones);
+    return x;
+}
+
+static void vec_gen(struct vec_loop *vl)
+{
+    static const int rc[2 + VEC_MAX_ARRAYS] = VEC_RC;
+    SValue *sv;
+    int base[VEC_MAX_ARRAYS];
+    int k, x, ri, rn, top, out = 0, es = vec_size(vl->lane);
+    int w = gen_vec_size() / es, uns = vl->ct & VT_UNSIGNED;
+    CType type;
+
+    save_regs(0);
+    for (k = 0; k < vl->nb_invs; ++k) {
+        if (vl->inv[k].sym) {
+            vec_push_sym(vl->inv[k].sym);
+        } else {
+            type.t = vl->inv[k].t, type.ref = NULL;
+            vsetc(&type, VT_CONST, &vl->inv[k].c);
+        }
+        gen_cast_s(vl->lane);
+        gen_vec_splat(VEC_INV_REG(k), vl->lane);
+    }
+    x = VEC_INV_REG(vl->nb_invs);
+    if (vl->ones) {
+        vl->ones = x--;
+        gen_vec_op(VEC_CMPEQ, VT_INT, vl->ones, vl->ones);
+    }
+    if (vl->acc) {
+        vl->acc = x;
+        gen_vec_op(VEC_XOR, vl->lane, vl->acc, vl->acc);
+    }
+
+    /* i, n and the arrays in registers, on the value stack */
+    sv = vtop + 1;
+    vec_push_sym(vl->i);
+    gen_cast_s(vl->ct);
+    gen_cast_s(VT_LLONG | uns);
+    gv(rc[0]);
+    if (vl->n) {
+        vec_push_sym(vl->n);
+    } else {
+        type.t = vl->nt, type.ref = NULL;
+        vsetc(&type, VT_CONST, &vl->nc);
+    }
+    gen_cast_s(vl->ct);
+    gen_cast_s(VT_LLONG | uns);
+    gv(rc[1]);
+    for (k = 0; k < vl->nb_arrays; ++k) {
+        vec_push_sym(vl->array[k]);
+        if (vl->array[k]->type.t & VT_ARRAY)
+            vtop->r &= ~VT_LVAL;
+        vtop->type = char_pointer_type;
+        gv(rc[2 + k]);
+    }
+    ri = sv[0].r, rn = sv[1].r;
+    for (k = 0; k < vl->nb_arrays; ++k)
+        base[k] = sv[2 + k].r;
+
+    if (vl->kind == '=') {
+        for (k = 0; k < vl->nb_arrays; ++k)
+            if (k != vl->dst && !((vl->array[k]->type.t & VT_ARRAY)
+                                  && (vl->array[vl->dst]->type.t & VT_ARRAY)))
+                out = gen_vec_overlap(base[vl->dst], base[k], out);
+    }
+    out = gen_vec_jmp(ri, rn, 0, w, uns ? TOK_UGT : TOK_GT, out);
+    top = gind();
+    if (vl->kind == TOK_BREAK) {
+        /* a vector past the end must not fault */
+        for (k = 0; k < vl->nb_arrays; ++k)
+            if (!vec_fixed(vl, k))
+                out = gen_vec_page(base[k], ri, es, out);
+    }
+    x = vec_eval(vl, vl->root, 0, 0, base, ri);
+    if (vl->kind == '=')
+        gen_vec_mem(1, x, base[vl->dst], ri, es);
+    else if (vl->kind == TOK_BREAK)
+        out = gen_vec_any(x, out);
+    else
+        gen_vec_op(vl->kind == TOK_A_ADD ? VEC_ADD : VEC_SUB, vl->lane,
+                   vl->acc, x);
+    gsym_addr(gen_vec_jmp(ri, rn, w, w, uns ? TOK_ULE : TOK_LE, 0), top);
+    gsym(out);
+
+    if (vl->acc) {
+        vec_push_sym(vl->s);
+        vdup();
+        gen_vec_reduce(vl->acc, 0, vl->lane);
+        gen_op('+');
+        vstore();
+        vpop();
+    }
+    gen_vec_end();
+    /* the loop goes on from there */
+    vec_push_sym(vl->i);
+    vpushv(sv);
+    gen_cast(&vl->i->type);
+    vstore();
+    vpop();
+    while (vtop >= sv)
+        vpop();
+}
+
+/* tok is the condition of a for loop */
+static void vec_for(void)
+{
+    struct vec_loop vl;
+
+    if (nocode_wanted || cur_inline)
+        return;
+    memset(&vl, 0, sizeof vl);
+    vl.str = tok_str_alloc();
+    if (vec_parse(&vl) && vec_prepare(&vl))
+        vec_gen(&vl);
+    /* compile the loop as written from what was read */
+    tok_str_add(vl.str, 0);
+    unget_tok(0);
+    begin_macro(vl.str, 1);
+    next();
+}
+#endif
+
+/* -finline-functions: bodies of at most INLINE_MAX_TOKENS tokens are
+   expanded at the call sites, nested up to INLINE_MAX_DEPTH times */
+#define INLINE_MAX_TOKENS 40
+#define INLINE_MAX_DEPTH 4
+#define INLINE_MAX_PARAMS 8
+
+/* save the body of the static function 'sym' (tok is '{') like
+   skip_or_save_block() and allow its calls to be inlined if it is
+   small and has no statics, labels, asm, alloca or setjmp */
+static void inline_save(Sym *sym, struct InlineFunc *fn)
+{
+    Sym *s = sym->type.ref;
+    int level = 0, n = 0, colons = 0, pack = -1, ok, t, w;
+    const char *name;
+
+    ok = s->f.func_type == FUNC_NEW && !debug_modes
+#ifdef CONFIG_NOOC_BCHECK
+        && !nooc_state->do_bounds_check
+#endif
+        ;
+    for (s = s->next; s; s = s->next, ++n)
+        if (s->type.t & VT_VLA)
+            ok = 0;
+    if (n > INLINE_MAX_PARAMS)
+        ok = 0;
+
+    fn->func_str = tok_str_alloc();
+    n = 0;
+    do {
+        t = tok;
+        if (t == TOK_EOF)
+            nooc_error("unexpected end of file");
+        /* as in regvar_scan() */
+        w = *nooc_state->pack_stack_ptr | nooc_state->ms_bitfields << 8;
+        if (w != pack) {
+            tok_str_add(fn->func_str, TOK_PACK);
+            tok_str_add(fn->func_str, pack = w);
+        }
+        tok_str_add_tok(fn->func_str);
+        next();
+        if (t == '{') {
+            ++level;
+        } else if (t == '}') {
+            --level;
+        } else if (t == '?' || t == TOK_CASE || t == TOK_DEFAULT) {
+            ++colons;
+        } else if (t == ':') {
+            /* more ':' than '?', 'case' and 'default': a label or a
+               bit-field */
+            if (--colons < 0)
+                ok = 0;
+        } else if (t == TOK_STATIC || t == TOK_GOTO
+                   || t == TOK_ASM1 || t == TOK_ASM2 || t == TOK_ASM3) {
+            ok = 0;
+        } else if (t >= TOK_UIDENT) {
+            name = get_tok_str(t, NULL);
+            if (strstr(name, "setjmp") || strstr(name, "alloca")
+                || strstr(name, "_address") || !strcmp(name, "vfork"))
+                ok = 0;
+        }
+        ++n;
+    } while (level);
+    tok_str_add(fn->func_str, -1);
+    tok_str_add(fn->func_str, 0);
+    if (ok && n <= INLINE_MAX_TOKENS) {
+        fn->call_sym = sym;
+        sym->a.inlinable = 1;
+    }
+}
+
+/* expand the call of 'f' (tok is '(') in place.  The arguments are
+   stored in new locals that the body, replayed from its saved tokens,
+   sees as its parameters.  The locals of the caller are hidden from it
+   meanwhile.  Returns 0 if the call must be done as usual. */
+static int gen_inline_call(Sym *f)
+{
+    struct InlineFunc *fn;
+    struct inline_ctx c, *p;
+    struct scope o, *lo = loop_scope;
+    struct switch_t *sw = cur_switch;
+    struct { Sym **pp, *s, *g; } *h = NULL;
+    CType ret_vt = func_vt, type;
+    const char *ret_name = funcname;
+    int ret_var = func_var;
+    Sym *s, *sa, *g, **pp;
+    int addr[INLINE_MAX_PARAMS];
+    int i, n, nh, size, align, v, pack, ms;
+
+    for (i = 0, p = cur_inline; p; p = p->prev)
+        if (++i == INLINE_MAX_DEPTH)
+            return 0;
+    for (i = 0; i < nooc_state->nb_inline_fns; ++i)
+        if (nooc_state->inline_fns[i]->call_sym == f)
+            break;
+    if (i == nooc_state->nb_inline_fns)
+        return 0;
+    fn = nooc_state->inline_fns[i];
+    if (fn->busy) /* recursive */
+        return 0;
+
+    vpop();
+#ifdef NOOC_TARGET_TAIL_CALL
+    /* 'return f(...)' with f inlined: no call of the body may jump */
+    tail_call_vtop = NULL;
+#endif
+    next();
+    s = f->type.ref;
+    sa = s->next;
+    for (n = 0; tok != ')'; ++n) {
+        expr_eq();
+        gfunc_param_typed(s, sa);
+        type = sa->type;
+        type.t &= ~(VT_CONSTANT | VT_VOLATILE);
+        size = type_size(&type, &align);
+        loc = (loc - size) & -align;
+        vset(&type, VT_LOCAL | VT_LVAL, addr[n] = loc);
+        vswap();
+        vstore();
+        vpop();
+        sa = sa->next;
+        if (tok == ')')
+            break;
+        skip(',');
+    }
+    if (sa)
+        nooc_error("too few arguments to function");
+    skip(')');
+    save_regs(0);
+
+    type = s->type;
+    type.t &= ~(VT_CONSTANT | VT_VOLATILE);
+    if ((type.t & VT_BTYPE) != VT_VOID) {
+        size = type_size(&type, &align);
+        c.ret = loc = (loc - size) & -align;
+    }
+
+    /* hide the locals of the caller, restored below */
+    for (nh = 0, g = local_stack; g; g = g->prev) {
+        v = g->v;
+        if ((v & SYM_FIELD) || (v & ~SYM_STRUCT) >= SYM_FIRST_ANOM)
+            continue;
+        pp = v & SYM_STRUCT
+            ? &table_ident[(v & ~SYM_STRUCT) - TOK_IDENT]->sym_struct
+            : &table_ident[v - TOK_IDENT]->sym_identifier;
+        if (*pp != g)
+            continue;
+        for (sa = g; sa && sym_scope(sa); sa = sa->prev_tok)
+            ;
+        if (sa == g)
+            continue;
+        h = nooc_realloc(h, (nh + 1) * sizeof *h);
+        h[nh].pp = pp, h[nh].s = g, h[nh++].g = sa;
+        *pp = sa;
+    }
+
+    new_scope(&o);
+    o.bsym = o.csym = NULL;
+    loop_scope = NULL;
+    cur_switch = NULL;
+    for (sa = s->next, i = 0; sa; sa = sa->next, ++i)
+        sym_push(sa->v & ~SYM_FIELD, &sa->type, VT_LOCAL | VT_LVAL, addr[i]);
+    c.rsym = 0;
+    c.level = local_scope + 1;
+    c.scope = &o;
+    c.prev = cur_inline;
+    cur_inline = &c;
+    func_vt = s->type;
+    func_var = 0;
+    funcname = get_tok_str(f->v, NULL);
+
+    fn->busy = 1;
+    pack = *nooc_state->pack_stack_ptr, ms = nooc_state->ms_bitfields;
+    unget_tok(0);
+    begin_macro(fn->func_str, 0);
+    next();
+    block(0);
+    end_macro();
+    *nooc_state->pack_stack_ptr = pack, nooc_state->ms_bitfields = ms;
+    next();
+    fn->busy = 0;
+
+    gsym(c.rsym);
+    nocode_wanted = 0;
+    prev_scope(&o, 0);
+    cur_inline = c.prev;
+    func_vt = ret_vt;
+    func_var = ret_var;
+    funcname = ret_name;
+    loop_scope = lo;
+    cur_switch = sw;
+    while (nh--) {
+        /* globals declared by the body go below the hidden locals */
+        for (g = h[nh].s; g->prev_tok != h[nh].g; g = g->prev_tok)
+            ;
+        g->prev_tok = *h[nh].pp;
+        *h[nh].pp = h[nh].s;
+    }
+    nooc_free(h);
+
+    if ((type.t & VT_BTYPE) != VT_VOID) {
+        vset(&type, VT_LOCAL | VT_LVAL, c.ret);
+        if ((type.t & VT_BTYPE) != VT_STRUCT)
+            gv(RC_TYPE(type.t));
+    } else {
+        vpush(&type);
+    }
+    return 1;
+}
+
 /* parse a function defined by symbol 'sym' and generate its code in
    'cur_text_section' */
 static void gen_function(Sym *sym)
 {
     struct scope f = { 0 };
+    TokenString *body = NULL;
     cur_scope = root_scope = &f;
     nocode_wanted = 0;
 
+    /* the line tables of the debug info assume a single .text */
+    if (nooc_state->function_sections && !debug_modes
+        && cur_text_section == text_section)
+        cur_text_section = find_subsection(nooc_state, text_section,
+                                           get_tok_str(sym->v, NULL));
     ind = cur_text_section->data_offset;
     if (sym->a.aligned) {
 	size_t newoff = section_add(cur_text_section, 0,
@@ -8300,10 +9935,37 @@ static void gen_function(Sym *sym)
     /* put debug symbol */
     nooc_debug_funcstart(nooc_state, sym);
 
+    func_regvars = 0;
+#ifdef NOOC_TARGET_VECTORIZE
+    func_vectorize = 0;
+#endif
+#ifdef NOOC_TARGET_REGVARS
+    if ((nooc_state->optimize || nooc_state->vectorize) && !debug_modes
+        && !func_var
+#ifdef CONFIG_NOOC_BCHECK
+        && !nooc_state->do_bounds_check
+#endif
+        ) {
+        int n = regvar_scan(&body);
+        if (nooc_state->optimize)
+            func_regvars = n;
+#ifdef NOOC_TARGET_VECTORIZE
+        func_vectorize = nooc_state->vectorize && n;
+#endif
+        begin_macro(body, 1);
+        next();
+    }
+#endif
+
     /* push a dummy symbol to enable local sym storage */
     sym_push2(&local_stack, SYM_FIELD, 0, 0);
     local_scope = 1; /* for function parameters */
+    func_leaf = 1;
     gfunc_prolog(sym);
+#ifdef NOOC_TARGET_REGVARS
+    if (func_regvars)
+        regvar_params(sym);
+#endif
     nooc_debug_prolog_epilog(nooc_state, 0);
 
     local_scope = 0;
@@ -8342,6 +10004,11 @@ static void gen_function(Sym *sym)
 
     /* do this after funcend debug info */
     next();
+    if (body) {
+        /* back to the token after the body */
+        end_macro();
+        next();
+    }
 }
 
 static void gen_inline_functions(NOOCState *s)
@@ -8362,11 +10029,13 @@ static void gen_inline_functions(NOOCState *s)
                    generate its code and convert it to a normal function */
                 fn->sym = NULL;
                 nooc_debug_putfile(s, fn->filename);
-                begin_macro(fn->func_str, 1);
+                fn->busy = 1;
+                begin_macro(fn->func_str, 0);
                 next();
                 cur_text_section = text_section;
                 gen_function(sym);
                 end_macro();
+                fn->busy = 0;
 
                 inline_generated = 1;
             }
@@ -8378,10 +10047,12 @@ static void gen_inline_functions(NOOCState *s)
 static void free_inline_functions(NOOCState *s)
 {
     int i;
-    /* free tokens of unused inline functions */
+    /* free the saved tokens */
     for (i = 0; i < s->nb_inline_fns; ++i) {
         struct InlineFunc *fn = s->inline_fns[i];
-        if (fn->sym)
+        if (fn->busy) /* after an error, see preprocess_end() */
+            fn->func_str->alloc = 1;
+        else
             tok_str_free(fn->func_str);
     }
     dynarray_reset(&s->inline_fns, &s->nb_inline_fns);
@@ -8562,12 +10233,36 @@ static int decl(int l)
                    the compilation unit only if they are used */
                 if (sym->type.t & VT_INLINE) {
                     struct InlineFunc *fn;
-                    fn = nooc_malloc(sizeof *fn + strlen(file->filename));
+                    fn = nooc_mallocz(sizeof *fn + strlen(file->filename));
                     strcpy(fn->filename, file->filename);
                     fn->sym = sym;
-		    skip_or_save_block(&fn->func_str);
+                    if (nooc_state->inline_functions)
+                        inline_save(sym, fn);
+                    else
+		        skip_or_save_block(&fn->func_str);
+                    dynarray_add(&nooc_state->inline_fns,
+				 &nooc_state->nb_inline_fns, fn);
+                } else if (nooc_state->inline_functions
+                           && (sym->type.t & VT_STATIC)) {
+                    /* save the body for gen_inline_call() and replay
+                       it to generate the function now */
+                    struct InlineFunc *fn;
+                    fn = nooc_mallocz(sizeof *fn + strlen(file->filename));
+                    strcpy(fn->filename, file->filename);
+                    inline_save(sym, fn);
                     dynarray_add(&nooc_state->inline_fns,
 				 &nooc_state->nb_inline_fns, fn);
+                    cur_text_section = ad.section;
+                    if (!cur_text_section)
+                        cur_text_section = text_section;
+                    fn->busy = 1;
+                    unget_tok(0);
+                    begin_macro(fn->func_str, 0);
+                    next();
+                    gen_function(sym);
+                    end_macro();
+                    next();
+                    fn->busy = 0;
                 } else {
                     /* compute text section */
                     cur_text_section = ad.section;
@@ -42,20 +42,39 @@ ST_DATA TokenSym **table_ident;
 
 /* ------------------------------------------------------------------------- */
 
-static TokenSym *hash_ident[TOK_HASH_SIZE];
-static char token_buf[STRING_MAX_SIZE + 1];
-static CString cstr_buf;
-static TokenString tokstr_buf;
-static unsigned char isidnum_table[256 - CH_EOF];
-static int pp_debug_tok, pp_debug_symv;
-static int pp_expr;
-static int pp_counter;
+static ST_TLS TokenSym **hash_ident;
+static ST_TLS int hash_ident_size; /* grows with tok_ident */
+static ST_TLS char token_buf[STRING_MAX_SIZE + 1];
+static ST_TLS CString cstr_buf;
+static ST_TLS TokenString tokstr_buf;
+static ST_TLS unsigned char isidnum_table[256 - CH_EOF];
+static ST_TLS int pp_debug_tok, pp_debug_symv;
+static ST_TLS int pp_expr;
+static ST_TLS int pp_counter;
 static void tok_print(const char *msg, const int *str);
+static ST_TLS CString pp_out; /* -E output, see pp_flush() */
+static void pp_flush(NOOCState *s1);
 
-static struct TinyAlloc *toksym_alloc;
-static struct TinyAlloc *tokstr_alloc;
+static ST_TLS struct TinyAlloc *toksym_alloc;
+static ST_TLS struct TinyAlloc *tokstr_alloc;
 
-static TokenString *macro_stack;
+static ST_TLS TokenString *macro_stack;
+
+/* expansions of object-like macros, see macro_subst_tok() */
+typedef struct MacroCache {
+    Sym *s;
+    unsigned gen; /* macro_gen when stored */
+    int flags; /* parse_flags when stored */
+    int len, lastlen;
+    int *str;
+} MacroCache;
+
+#define MACRO_CACHE_SIZE 256
+static ST_TLS MacroCache macro_cache[MACRO_CACHE_SIZE];
+static ST_TLS unsigned macro_gen; /* incremented by each #define/#undef */
+static ST_TLS unsigned macro_nb_subst;
+static ST_TLS unsigned macro_nb_ctx; /* incremented by __LINE__ & co and
+    by function-like macros that look past the end of a token string */
 
 static const char nooc_keywords[] = 
 #define DEF(id, str) str "\0"
@@ -456,6 +475,49 @@ static void add_char(CString *cstr, int c)
 }
 
 /* ------------------------------------------------------------------------- */
+/* FNV-1a, one character at a time so that the lexer can hash while it
+   scans.  The bucket is taken from the low bits after tok_hash_mix(),
+   which makes every bit of the result depend on every character. */
+#define TOK_HASH_INIT 0x811c9dc5
+#define TOK_HASH_FUNC(h, c) (((h) ^ (c)) * 0x01000193)
+
+static inline unsigned int tok_hash_mix(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    return h ^ h >> 16;
+}
+
+static unsigned int tok_hash(const char *str, int len)
+{
+    unsigned int h = TOK_HASH_INIT;
+    int i;
+
+    for(i = 0; i < len; i++)
+        h = TOK_HASH_FUNC(h, ((unsigned char *)str)[i]);
+    return tok_hash_mix(h);
+}
+
+/* (re)build hash_ident with 'size' buckets from table_ident */
+static void tok_hash_resize(int size)
+{
+    TokenSym *ts, **pts;
+    int i;
+
+    nooc_free(hash_ident);
+    hash_ident = nooc_mallocz(size * sizeof(TokenSym *));
+    hash_ident_size = size;
+    /* backwards, so that older tokens (keywords) stay first in a chain */
+    for(i = tok_ident - TOK_IDENT; --i >= 0;) {
+        ts = table_ident[i];
+        pts = &hash_ident[tok_hash(ts->str, ts->len) & (size - 1)];
+        ts->hash_next = *pts;
+        *pts = ts;
+    }
+}
+
 /* allocate a new token */
 static TokenSym *tok_alloc_new(TokenSym **pts, const char *str, int len)
 {
@@ -484,26 +546,18 @@ static TokenSym *tok_alloc_new(TokenSym **pts, const char *str, int len)
     memcpy(ts->str, str, len);
     ts->str[len] = '\0';
     *pts = ts;
+    /* keep the load factor at most 1 */
+    if (i >= hash_ident_size)
+        tok_hash_resize(2 * hash_ident_size);
     return ts;
 }
 
-#define TOK_HASH_INIT 1
-#define TOK_HASH_FUNC(h, c) ((h) + ((h) << 5) + ((h) >> 27) + (c))
-
-
 /* find a token and add it if not found */
 ST_FUNC TokenSym *tok_alloc(const char *str, int len)
 {
     TokenSym *ts, **pts;
-    int i;
-    unsigned int h;
-    
-    h = TOK_HASH_INIT;
-    for(i=0;i<len;i++)
-        h = TOK_HASH_FUNC(h, ((unsigned char *)str)[i]);
-    h &= (TOK_HASH_SIZE - 1);
 
-    pts = &hash_ident[h];
+    pts = &hash_ident[tok_hash(str, len) & (hash_ident_size - 1)];
     for(;;) {
         ts = *pts;
         if (!ts)
@@ -581,6 +635,8 @@ ST_FUNC const char *get_tok_str(int v, CValue *cv)
         return strcpy(p, "<long double>");
     case TOK_LINENUM:
         return strcpy(p, "<linenumber");
+    case TOK_PACK:
+        return strcpy(p, "<pack>");
 
     /* above tokens have value, the ones below don't */
     case TOK_LT:
@@ -744,6 +800,36 @@ static int handle_stray(uint8_t **p)
         c = handle_stray(&p); \
 }
 
+/* return the first 'p' at or after 'p' with '*p' in 'set' (of 'n' chars)
+   or file->buf_end, looking at 16 bytes at a time with SSE2.  The callers
+   still check each char after that, so without SSE2 it just returns 'p'
+   (word-at-a-time tricks were not faster than their byte loops). */
+#if NOOC_SCAN_SSE2
+# define NOOC_SCAN 1
+static inline uint8_t *scan_chars(uint8_t *p, const char *set, int n)
+{
+    uint8_t *end = file->buf_end;
+    int i, m;
+
+    for (; p + 16 <= end; p += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *)p), x = _mm_setzero_si128();
+        for (i = 0; i < n; i++)
+            x = _mm_or_si128(x, _mm_cmpeq_epi8(v, _mm_set1_epi8(set[i])));
+        m = _mm_movemask_epi8(x);
+        if (m)
+            return p + __builtin_ctz(m);
+    }
+    for (; p < end; p++)
+        for (i = 0; i < n; i++)
+            if (*p == (uint8_t)set[i])
+                return p;
+    return p;
+}
+#else
+# define NOOC_SCAN 0
+# define scan_chars(p, set, n) (p)
+#endif
+
 static int skip_spaces(void)
 {
     int ch;
@@ -759,6 +845,7 @@ static uint8_t *parse_line_comment(uint8_t *p)
 {
     int c;
     for(;;) {
+        p = scan_chars(p + 1, "\n\\", 2) - 1;
         for (;;) {
             c = *++p;
     redo:
@@ -785,6 +872,7 @@ static uint8_t *parse_comment(uint8_t *p)
     int c;
     for(;;) {
         /* fast skip loop */
+        p = scan_chars(p + 1, "\n*\\", 3) - 1;
         for(;;) {
             c = *++p;
         redo:
@@ -822,7 +910,18 @@ static uint8_t *parse_comment(uint8_t *p)
 static uint8_t *parse_pp_string(uint8_t *p, int sep, CString *str)
 {
     int c;
+#if NOOC_SCAN
+    uint8_t *q;
+    char set[4];
+    set[0] = sep, set[1] = '\\', set[2] = '\n', set[3] = '\r';
+#endif
     for(;;) {
+#if NOOC_SCAN
+        q = scan_chars(p + 1, set, 4) - 1;
+        if (str && q > p)
+            cstr_cat(str, (char *)p + 1, q - p);
+        p = q;
+#endif
         c = *++p;
     redo:
         if (c == sep) {
@@ -963,7 +1062,7 @@ redo_start:
             break;
 _default:
         default:
-            p++;
+            p = scan_chars(p + 1, "\n\\\"'/#", 6);
             break;
         }
         start_of_line = 0;
@@ -985,6 +1084,7 @@ static inline int tok_size(const int *p)
     case TOK_LCHAR:
     case TOK_CFLOAT:
     case TOK_LINENUM:
+    case TOK_PACK:
         return 1 + 1;
     case TOK_STR:
     case TOK_LSTR:
@@ -1117,6 +1217,7 @@ static void tok_str_add2(TokenString *s, int t, CValue *cv)
     case TOK_LCHAR:
     case TOK_CFLOAT:
     case TOK_LINENUM:
+    case TOK_PACK:
 #if LONG_SIZE == 4
     case TOK_CLONG:
     case TOK_CULONG:
@@ -1200,6 +1301,7 @@ static inline void tok_get(int *t, const int **pp, CValue *cv)
     case TOK_CCHAR:
     case TOK_LCHAR:
     case TOK_LINENUM:
+    case TOK_PACK:
         cv->i = *p++;
         break;
 #if LONG_SIZE == 4
@@ -1290,6 +1392,7 @@ ST_INLN void define_push(int v, int macro_type, int *str, Sym *first_arg)
     s->d = str;
     s->next = first_arg;
     table_ident[v - TOK_IDENT]->sym_define = s;
+    macro_gen++;
 
     if (o && !macro_is_equal(o->d, s->d))
 	nooc_warning("%s redefined", get_tok_str(v, NULL));
@@ -1301,6 +1404,7 @@ ST_FUNC void define_undef(Sym *s)
     int v = s->v;
     if (v >= TOK_IDENT && v < tok_ident)
         table_ident[v - TOK_IDENT]->sym_define = NULL;
+    macro_gen++;
 }
 
 ST_INLN Sym *define_find(int v)
@@ -1334,12 +1438,15 @@ static void maybe_run_test(NOOCState *s)
         return;
     if (0 != --s->run_test)
         return;
+    pp_flush(s);
     fprintf(s->ppfp, &"\n[%s]\n"[!(s->dflag & 32)], p), fflush(s->ppfp);
     define_push(tok, MACRO_OBJ, NULL, NULL);
 }
 
 static CachedInclude *
 search_cached_include(NOOCState *s1, const char *filename, int add);
+static CachedInclude *search_cached_ino(NOOCState *s1, uint64_t dev, uint64_t ino);
+static void pch_load(NOOCState *s1);
 
 static int parse_include(NOOCState *s1, int do_next, int test)
 {
@@ -1403,6 +1510,8 @@ static int parse_include(NOOCState *s1, int do_next, int test)
                 nooc_error("include file '%s' not found", name);
             pstrcpy(buf, sizeof buf, p);
             pstrcat(buf, sizeof buf, "/");
+            if (!nooc_incdir_has(s1, buf, name))
+                continue;
         }
         pstrcat(buf, sizeof buf, name);
         e = search_cached_include(s1, buf, 0);
@@ -1412,6 +1521,8 @@ static int parse_include(NOOCState *s1, int do_next, int test)
 #ifdef INC_DEBUG
             printf("%s: skipping cached %s\n", file->filename, buf);
 #endif
+            if (!test)
+                s1->include_hits++;
             return 1;
         }
         if (nooc_open(s1, buf) >= 0)
@@ -1421,8 +1532,22 @@ static int parse_include(NOOCState *s1, int do_next, int test)
     if (test) {
         nooc_close();
     } else {
+        e = search_cached_ino(s1, file->dev, file->ino);
+        if (e && (define_find(e->ifndef_macro) || e->once)) {
+            /* the same guarded file by another name: skip, and remember
+               this name so that the next time needs no open() */
+            nooc_close();
+            c = e->ifndef_macro, i = e->once;
+            e = search_cached_include(s1, buf, 1);
+            e->ifndef_macro = c, e->once = i;
+            s1->include_hits++;
+            return 1;
+        }
+        s1->include_misses++;
         if (s1->include_stack_ptr >= s1->include_stack + INCLUDE_STACK_SIZE)
             nooc_error("#include recursion too deep");
+        if (!PATHCMP(nooc_fileextension(buf), ".nch"))
+            pch_load(s1);
         /* push previous file on stack */
         *s1->include_stack_ptr++ = file->prev;
         file->include_next_index = i;
@@ -1430,12 +1555,13 @@ static int parse_include(NOOCState *s1, int do_next, int test)
         printf("%s: including %s\n", file->prev->filename, file->filename);
 #endif
         /* update target deps */
-        if (s1->gen_deps) {
+        if (s1->gen_deps || s1->gen_pch) {
             BufferedFile *bf = file;
             while (i == 1 && (bf = bf->prev))
                 i = bf->include_next_index;
-            /* skip system include files */
-            if (s1->include_sys_deps || i - 2 < s1->nb_include_paths)
+            /* skip system include files (a .nch needs all of them) */
+            if (s1->include_sys_deps || s1->gen_pch
+             || i - 2 < s1->nb_include_paths)
                 dynarray_add(&s1->target_deps, &s1->nb_target_deps,
                     nooc_strdup(buf));
         }
@@ -1626,16 +1752,18 @@ static CachedInclude *search_cached_include(NOOCState *s1, const char *filename,
 #endif
         s++;
     }
-    h &= (CACHED_INCLUDES_HASH_SIZE - 1);
+    h = tok_hash_mix(h);
 
-    i = s1->cached_includes_hash[h];
+    i = s1->cached_includes_hash_size
+        ? s1->cached_includes_hash[h & (s1->cached_includes_hash_size - 1)]
+        : 0;
     for(;;) {
         if (i == 0)
             break;
         e = s1->cached_includes[i - 1];
         if (0 == PATHCMP(filename, e->filename))
             return e;
-        if (e->once
+        if (e->once && !e->ino
             && 0 == PATHCMP(basename, nooc_basename(e->filename))
             && 0 == normalized_PATHCMP(filename, e->filename)
             )
@@ -1648,16 +1776,73 @@ static CachedInclude *search_cached_include(NOOCState *s1, const char *filename,
     e = nooc_malloc(sizeof(CachedInclude) + (len = strlen(filename)));
     memcpy(e->filename, filename, len + 1);
     e->ifndef_macro = e->once = 0;
+    e->hash = h;
+    e->dev = e->ino = 0;
     dynarray_add(&s1->cached_includes, &s1->nb_cached_includes, e);
-    /* add in hash table */
-    e->hash_next = s1->cached_includes_hash[h];
-    s1->cached_includes_hash[h] = s1->nb_cached_includes;
+    /* add in hash table, doubling it when full */
+    len = s1->cached_includes_hash_size;
+    if (s1->nb_cached_includes > len) {
+        len = len ? len * 2 : CACHED_INCLUDES_HASH_SIZE;
+        s1->cached_includes_hash = nooc_realloc(s1->cached_includes_hash, len * sizeof(int));
+        s1->cached_ino_hash = nooc_realloc(s1->cached_ino_hash, len * sizeof(void *));
+        s1->cached_includes_hash_size = len;
+        memset(s1->cached_includes_hash, 0, len * sizeof(int));
+        memset(s1->cached_ino_hash, 0, len * sizeof(void *));
+        i = 0;
+    } else {
+        i = s1->nb_cached_includes - 1;
+    }
+    for (; i < s1->nb_cached_includes; i++) {
+        e = s1->cached_includes[i];
+        h = e->hash & (len - 1);
+        e->hash_next = s1->cached_includes_hash[h];
+        s1->cached_includes_hash[h] = i + 1;
+        if (e->ino) {
+            h = CACHED_INO_HASH(e->dev, e->ino) & (len - 1);
+            e->ino_next = s1->cached_ino_hash[h];
+            s1->cached_ino_hash[h] = e;
+        }
+    }
 #ifdef INC_DEBUG
     printf("adding cached '%s'\n", filename);
 #endif
     return e;
 }
 
+/* find a guarded include by file identity, so that a header reached
+   by another path (symlink, "dir/../x.h") is recognized too */
+static CachedInclude *search_cached_ino(NOOCState *s1, uint64_t dev, uint64_t ino)
+{
+    CachedInclude *e = NULL;
+    if (ino && s1->cached_includes_hash_size) {
+        e = s1->cached_ino_hash[CACHED_INO_HASH(dev, ino) & (s1->cached_includes_hash_size - 1)];
+        while (e && (e->ino != ino || e->dev != dev))
+            e = e->ino_next;
+    }
+    return e;
+}
+
+/* remember that 'filename' (file identity dev:ino, if known) is guarded */
+static CachedInclude *cache_guard(NOOCState *s1, const char *filename,
+                                  uint64_t dev, uint64_t ino)
+{
+    CachedInclude *e = search_cached_include(s1, filename, 1);
+    unsigned h;
+    if (ino && !e->ino && !search_cached_ino(s1, dev, ino)) {
+        e->dev = dev, e->ino = ino;
+        h = CACHED_INO_HASH(dev, ino) & (s1->cached_includes_hash_size - 1);
+        e->ino_next = s1->cached_ino_hash[h];
+        s1->cached_ino_hash[h] = e;
+    }
+    return e;
+}
+
+/* remember that the current file is guarded */
+static CachedInclude *cache_file_guard(NOOCState *s1)
+{
+    return cache_guard(s1, file->filename, file->dev, file->ino);
+}
+
 static void pragma_parse(NOOCState *s1)
 {
     next_nomacro();
@@ -1688,9 +1873,10 @@ static void pragma_parse(NOOCState *s1)
         else
             nooc_warning("unbalanced #pragma pop_macro");
         pp_debug_tok = t, pp_debug_symv = v;
+        macro_gen++;
 
     } else if (tok == TOK_once) {
-        search_cached_include(s1, file->filename, 1)->once = 1;
+        cache_file_guard(s1)->once = 1;
 
     } else if (s1->output_type == NOOC_OUTPUT_PREPROCESS) {
         /* nooc -E: keep pragmas below unchanged */
@@ -1700,6 +1886,8 @@ static void pragma_parse(NOOCState *s1)
         unget_tok(TOK_LINEFEED);
 
     } else if (tok == TOK_pack) {
+        if (s1->gen_pch)
+            nooc_error("#pragma pack not supported in precompiled headers");
         /* This may be:
            #pragma pack(1) // set
            #pragma pack() // reset to default
@@ -2544,6 +2732,16 @@ static inline void next_nomacro1(void)
             goto parse_simple;
         if (c == CH_EOF) {
             NOOCState *s1 = nooc_state;
+            if (file->pch_str) {
+                /* replay the tokens of a precompiled header */
+                TokenString *str = tok_str_alloc();
+                str->str = file->pch_str;
+                file->pch_str = NULL;
+                file->buf_ptr = p;
+                begin_macro(str, 2);
+                next_nomacro();
+                return;
+            }
             if ((parse_flags & PARSE_FLAG_LINEFEED)
                 && !(tok_flags & TOK_FLAG_EOF)) {
                 tok_flags |= TOK_FLAG_EOF;
@@ -2566,8 +2764,7 @@ static inline void next_nomacro1(void)
 #ifdef INC_DEBUG
                     printf("#endif %s\n", get_tok_str(file->ifndef_macro_saved, NULL));
 #endif
-                    search_cached_include(s1, file->filename, 1)
-                        ->ifndef_macro = file->ifndef_macro_saved;
+                    cache_file_guard(s1)->ifndef_macro = file->ifndef_macro_saved;
                     tok_flags &= ~TOK_FLAG_ENDIF;
                 }
 
@@ -2657,8 +2854,7 @@ maybe_newline:
 
             /* fast case : no stray found, so we have the full token
                and we have already hashed it */
-            h &= (TOK_HASH_SIZE - 1);
-            pts = &hash_ident[h];
+            pts = &hash_ident[tok_hash_mix(h) & (hash_ident_size - 1)];
             for(;;) {
                 ts = *pts;
                 if (!ts)
@@ -3154,6 +3350,7 @@ static int next_argstream(Sym **nested_list, TokenString *ws_str)
                     tok_str_add(ws_str, t), t = *++p;
             }
             if (t == 0) {
+                macro_nb_ctx++;
                 end_macro();
                 /* also, end of scope for nested defined symbol */
                 sa = *nested_list;
@@ -3166,6 +3363,7 @@ static int next_argstream(Sym **nested_list, TokenString *ws_str)
         } else {
             uint8_t *p = file->buf_ptr;
             int ch = handle_bs(&p);
+            macro_nb_ctx++;
             if (ws_str) {
                 while (is_space(ch) || ch == '\n' || ch == '/') {
                     if (ch == '/') {
@@ -3217,6 +3415,9 @@ static int macro_subst_tok(
 
     /* if symbol is a macro, prepare substitution */
     /* special macros */
+    if (tok == TOK___LINE__ || tok == TOK___COUNTER__
+     || tok == TOK___FILE__ || tok == TOK___DATE__ || tok == TOK___TIME__)
+        macro_nb_ctx++;
     if (tok == TOK___LINE__ || tok == TOK___COUNTER__) {
         t = tok == TOK___LINE__ ? file->line_num : pp_counter++;
         snprintf(buf, sizeof(buf), "%d", t);
@@ -3252,6 +3453,24 @@ static int macro_subst_tok(
         int saved_parse_flags = parse_flags;
 	int *joined_str = NULL;
         int *mstr = s->d;
+        MacroCache *mc = NULL;
+        unsigned nb_subst = macro_nb_subst++, nb_ctx = macro_nb_ctx;
+        int len = tok_str->len;
+
+        if (s->type.t == MACRO_OBJ && !*nested_list && !pp_expr) {
+            /* Outside of other macros the expansion of an object-like
+               macro depends only on the macros defined. */
+            mc = &macro_cache[((uintptr_t)s / sizeof(Sym)) & (MACRO_CACHE_SIZE - 1)];
+            if (mc->s == s && mc->gen == macro_gen && mc->flags == parse_flags) {
+                if (len + mc->len >= tok_str->allocated_len)
+                    tok_str_realloc(tok_str, len + mc->len + 1);
+                memcpy(tok_str->str + len, mc->str, mc->len * sizeof(int));
+                tok_str->len = len + mc->len;
+                if (mc->lastlen >= 0)
+                    tok_str->lastlen = len + mc->lastlen;
+                return 0;
+            }
+        }
 
         if (s->type.t == MACRO_FUNC) {
             /* whitespace between macro name and argument list */
@@ -3374,6 +3593,20 @@ static int macro_subst_tok(
 	    tok_str_free_str(joined_str);
         if (mstr != s->d)
             tok_str_free_str(mstr);
+
+        /* keep it if other macros were expanded, unless it used
+           __LINE__ & co or looked at the tokens that follow */
+        if (mc && macro_nb_subst != nb_subst + 1
+            && macro_nb_ctx == nb_ctx && tok_str->len > len) {
+            tok_str_free_str(mc->str);
+            mc->s = s;
+            mc->gen = macro_gen;
+            mc->flags = parse_flags;
+            mc->len = tok_str->len - len;
+            mc->lastlen = tok_str->lastlen - len;
+            mc->str = tal_realloc(tokstr_alloc, NULL, mc->len * sizeof(int));
+            memcpy(mc->str, tok_str->str + len, mc->len * sizeof(int));
+        }
     }
     return 0;
 }
@@ -3461,6 +3694,12 @@ static void next_nomacro(void)
                 file->line_num = tokc.i;
                 goto redo;
             }
+            if (t == TOK_PACK) {
+                /* state of a replayed function body, see regvar_scan() */
+                *nooc_state->pack_stack_ptr = tokc.i & 0xff;
+                nooc_state->ms_bitfields = tokc.i >> 8;
+                goto redo;
+            }
         } else {
             macro_ptr++;
             if (t < TOK_IDENT) {
@@ -3532,6 +3771,465 @@ ST_INLN void unget_tok(int last_tok)
     tok = last_tok;
 }
 
+/* ------------------------------------------------------------------------- */
+/* precompiled headers
+
+   'nooc -pch header.h' preprocesses header.h and writes header.nch with
+   the identifiers, macros and include guards known at its end and the
+   tokens that the parser would see.  '#include "header.nch"' (or
+   '-include header.nch') then defines the macros and replays the tokens
+   instead of reading and lexing the headers again.  If the .nch was made
+   with other predefined macros or if one of the headers has changed
+   since, header.h is included as usual. */
+
+#define PCH_MAGIC "NOOCPCH"
+#define PCH_VERSION 2
+#define PCH_PAD (4 * sizeof(int)) /* room after the data for tok_get() */
+
+static unsigned pch_hash(unsigned h, const char *p, int n)
+{
+    while (--n >= 0)
+        h = (h ^ (unsigned char)*p++) * 16777619;
+    return h;
+}
+
+/* append 'n' bytes, padded to the size of an int */
+static void pch_put(CString *cs, const void *p, int n)
+{
+    cstr_cat(cs, p, n);
+    while (cs->size & (sizeof(int) - 1))
+        cstr_ccat(cs, 0);
+}
+
+static void pch_put_int(CString *cs, int v)
+{
+    pch_put(cs, &v, sizeof v);
+}
+
+static void pch_put_str(CString *cs, const char *str)
+{
+    int n = strlen(str) + 1;
+    pch_put_int(cs, n);
+    pch_put(cs, str, n);
+}
+
+static void pch_put_tokens(CString *cs, const int *str)
+{
+    const int *p = str;
+    CValue cv;
+    int t;
+
+    do
+        TOK_GET(&t, &p, &cv);
+    while (t);
+    pch_put_int(cs, p - str);
+    pch_put(cs, str, (p - str) * sizeof(int));
+}
+
+/* size and modification time of 'filename', with the nanoseconds
+   where known: generated headers are often rewritten within a second */
+static int pch_stat(const char *filename, unsigned long long st[3])
+{
+    struct stat sb;
+    if (stat(filename, &sb))
+        return -1;
+    st[0] = sb.st_size;
+    st[1] = sb.st_mtime;
+#if defined _WIN32
+    st[2] = 0;
+#elif defined __APPLE__
+    st[2] = sb.st_mtimespec.tv_nsec;
+#else
+    st[2] = sb.st_mtim.tv_nsec;
+#endif
+    return 0;
+}
+
+/* file names are stored absolute, so that the .nch works from any
+   directory */
+static void pch_put_name(CString *cs, const char *filename)
+{
+    char *name = nooc_abspath(filename);
+    pch_put_str(cs, name);
+    nooc_free(name);
+}
+
+static void pch_put_dep(CString *cs, const char *filename)
+{
+    unsigned long long st[3];
+    if (pch_stat(filename, st))
+        nooc_error("cannot stat '%s'", filename);
+    pch_put(cs, st, sizeof st);
+    pch_put_name(cs, filename);
+}
+
+/* nooc -pch: preprocess the file and store the result in s1->pch_data */
+ST_FUNC void nooc_pch_create(NOOCState *s1)
+{
+    CString *cs = &s1->pch_data;
+    TokenString *str;
+    BufferedFile *bf;
+    char filename[1024];
+    Sym *s, *d, *a, *base;
+    int i, n, pos, old;
+
+    if (parse_flags & PARSE_FLAG_ASM_FILE)
+        nooc_error("cannot precompile assembler files");
+    parse_flags = PARSE_FLAG_PREPROCESS | PARSE_FLAG_TOK_NUM | PARSE_FLAG_TOK_STR;
+
+    /* run "<command line>" on its own first.  Its macros and tokens
+       are those of the file that will include the .nch, too. */
+    bf = file->prev;
+    file->prev = NULL;
+    s1->include_stack_ptr = s1->include_stack;
+    do
+        next();
+    while (tok != TOK_EOF);
+    nooc_close();
+    file = bf;
+    tok_flags = TOK_FLAG_BOL | TOK_FLAG_BOF;
+    base = define_stack;
+    pstrcpy(filename, sizeof filename, file->true_filename);
+
+    str = tok_str_alloc();
+    for (;;) {
+        next();
+        if (tok == TOK_EOF)
+            break;
+        tok_str_add_tok(str);
+    }
+    tok_str_add(str, 0);
+
+    cstr_reset(cs);
+    pch_put(cs, PCH_MAGIC, sizeof PCH_MAGIC);
+    pch_put_int(cs, PCH_VERSION);
+    pch_put_name(cs, filename);
+    pch_put_int(cs, s1->pch_ctx);
+
+    /* files this depends on */
+    pch_put_int(cs, 1 + s1->nb_target_deps);
+    pch_put_dep(cs, filename);
+    for (i = 0; i < s1->nb_target_deps; i++)
+        pch_put_dep(cs, s1->target_deps[i]);
+
+    /* identifiers, by token number */
+    n = tok_ident - TOK_IDENT;
+    pch_put_int(cs, n);
+    for (i = 0; i < n; i++)
+        pch_put_str(cs, table_ident[i]->str);
+
+    /* new macros, and #undefs */
+    pos = cs->size, n = old = 0;
+    pch_put_int(cs, n);
+    for (s = define_stack; s; s = s->prev) {
+        if (s == base)
+            old = 1;
+        if (s->v & SYM_FIELD)
+            continue;
+        d = define_find(s->v);
+        if (d && (d != s || !d->d || old))
+            continue;
+        pch_put_int(cs, s->v);
+        if (!d) {
+            pch_put_int(cs, -1);
+        } else {
+            pch_put_int(cs, d->type.t);
+            for (i = 0, a = d->next; a; a = a->next)
+                ++i;
+            pch_put_int(cs, i);
+            for (a = d->next; a; a = a->next) {
+                pch_put_int(cs, a->v & ~SYM_FIELD);
+                pch_put_int(cs, a->type.t);
+            }
+            pch_put_tokens(cs, d->d);
+        }
+        ++n;
+    }
+    memcpy(cs->data + pos, &n, sizeof n);
+
+    /* include guards and #pragma once */
+    pch_put_int(cs, s1->nb_cached_includes);
+    for (i = 0; i < s1->nb_cached_includes; i++) {
+        CachedInclude *e = s1->cached_includes[i];
+        pch_put_int(cs, e->ifndef_macro);
+        pch_put_int(cs, e->once);
+        pch_put_name(cs, e->filename);
+    }
+
+    /* #pragma comment(lib) */
+    pch_put_int(cs, s1->nb_pragma_libs);
+    for (i = 0; i < s1->nb_pragma_libs; i++)
+        pch_put_str(cs, s1->pragma_libs[i]);
+
+    pch_put_tokens(cs, str->str);
+    tok_str_free(str);
+}
+
+ST_FUNC int nooc_pch_write(NOOCState *s1, const char *filename)
+{
+    FILE *f;
+
+    f = fopen(filename, "wb");
+    if (!f)
+        return nooc_error_noabort("could not write '%s: %s'", filename, strerror(errno));
+    if (s1->verbose)
+        printf("<- %s\n", filename);
+    fwrite(s1->pch_data.data, 1, s1->pch_data.size, f);
+    if (fclose(f))
+        return nooc_error_noabort("could not write '%s: %s'", filename, strerror(errno));
+    return 0;
+}
+
+typedef struct PchReader {
+    int *p, *end;
+    int *map, nb_map; /* identifiers of the .nch -> ours */
+    int err;
+} PchReader;
+
+static int *pch_get(PchReader *r, int n)
+{
+    int *p = r->p;
+    if (n < 0 || n > r->end - p) {
+        r->err = 1;
+        return NULL;
+    }
+    r->p = p + n;
+    return p;
+}
+
+static int pch_get_int(PchReader *r)
+{
+    int *p = pch_get(r, 1);
+    return p ? *p : 0;
+}
+
+static const char *pch_get_str(PchReader *r)
+{
+    int n = pch_get_int(r);
+    char *p = (char *)pch_get(r, (n + sizeof(int) - 1) / sizeof(int));
+    if (!p || n < 1 || p[n - 1]) {
+        r->err = 1;
+        return "";
+    }
+    return p;
+}
+
+static int pch_get_tok(PchReader *r)
+{
+    int t = pch_get_int(r);
+    if (t >= TOK_IDENT) {
+        if (t - TOK_IDENT < r->nb_map)
+            return r->map[t - TOK_IDENT];
+        r->err = 1;
+    }
+    return t;
+}
+
+/* get a token string and renumber its identifiers in place */
+static int *pch_get_tokens(PchReader *r)
+{
+    int n = pch_get_int(r);
+    int *str = pch_get(r, n), *p = str, *end = str + n, t;
+    CValue cv;
+
+    if (str) {
+        while (p < end && (t = *p) != 0) {
+            if (t >= TOK_IDENT) {
+                if (t - TOK_IDENT >= r->nb_map)
+                    break;
+                *p++ = r->map[t - TOK_IDENT];
+            } else if (TOK_HAS_VALUE(t)) {
+                tok_get(&t, (const int **)&p, &cv);
+            } else {
+                p++;
+            }
+        }
+        if (p + 1 == end)
+            return str;
+    }
+    r->err = 1;
+    return NULL;
+}
+
+/* check that the .nch fits the current compilation */
+static const char *pch_check(NOOCState *s1, PchReader *r)
+{
+    unsigned long long *st, cur[3];
+    const char *name;
+    int n;
+
+    if (pch_get_int(r) != s1->pch_ctx)
+        return "was made with other predefined macros";
+    n = pch_get_int(r);
+    while (--n >= 0) {
+        st = (unsigned long long *)pch_get(r, sizeof cur / (sizeof(int)));
+        name = pch_get_str(r);
+        if (r->err)
+            break;
+        if (pch_stat(name, cur) || memcmp(st, cur, sizeof cur))
+            return "headers have changed";
+    }
+    return NULL;
+}
+
+/* report at the #include, the .nch has no lines */
+static void pch_error(const char *msg)
+{
+    char name[sizeof file->filename];
+    pstrcpy(name, sizeof name, file->filename);
+    nooc_close();
+    nooc_error("'%s' %s", name, msg);
+}
+
+/* #include of a .nch: define its macros and replace the file by its tokens */
+static void pch_load(NOOCState *s1)
+{
+    BufferedFile *bf = file;
+    PchReader r;
+    const char *hdr, *msg;
+    Sym *first, **ps;
+    int *buf, *str, size, n, i, v, t;
+    CachedInclude *e;
+    struct stat sb;
+
+    /* -E output or asm: use the original header */
+    msg = NULL;
+    if (s1->output_type == NOOC_OUTPUT_PREPROCESS
+     || (parse_flags & PARSE_FLAG_ASM_FILE))
+        msg = "";
+
+#if CONFIG_NOOC_MMAP
+    if (bf->map && bf->map + bf->map_size - bf->buf_end >= PCH_PAD) {
+        /* nooc_open_fd() mapped it privately: keep the mapping, the
+           tokens are renumbered and used in place */
+        buf = (int *)bf->buf_ptr;
+        size = bf->buf_end - bf->buf_ptr;
+        dynarray_add(&s1->pch_maps, &s1->nb_pch_maps, bf->map);
+        dynarray_add(&s1->pch_maps, &s1->nb_pch_maps, (void *)bf->map_size);
+        bf->map = NULL;
+        bf->buf_ptr = bf->buf_end;
+    } else
+#endif
+    {
+        if (bf->map) {
+            size = bf->buf_end - bf->buf_ptr;
+            buf = nooc_mallocz(size + PCH_PAD);
+            memcpy(buf, bf->buf_ptr, size);
+            bf->buf_ptr = bf->buf_end;
+        } else {
+            /* small files are read, as small sources are */
+            size = lseek(bf->fd, 0, SEEK_END);
+            lseek(bf->fd, 0, SEEK_SET);
+            if (size < 0)
+                size = 0;
+            buf = nooc_mallocz(size + PCH_PAD);
+            if (full_read(bf->fd, buf, size) != size)
+                size = 0;
+        }
+        dynarray_add(&s1->pch_bufs, &s1->nb_pch_bufs, buf);
+    }
+    if (size < sizeof PCH_MAGIC + sizeof(int)
+     || memcmp(buf, PCH_MAGIC, sizeof PCH_MAGIC))
+        pch_error("is not a precompiled header");
+
+    memset(&r, 0, sizeof r);
+    r.p = buf + sizeof PCH_MAGIC / sizeof(int);
+    r.end = buf + size / sizeof(int);
+    if (pch_get_int(&r) != PCH_VERSION)
+        pch_error("has a wrong precompiled header version");
+    hdr = pch_get_str(&r);
+    if (!msg && !r.err)
+        msg = pch_check(s1, &r);
+    if (r.err)
+        goto bad;
+    if (msg) {
+        char name[sizeof bf->filename];
+        pstrcpy(name, sizeof name, bf->filename);
+        nooc_close();
+        if (*msg)
+            nooc_warning("'%s' %s, including '%s'", name, msg, hdr);
+        if (nooc_open(s1, hdr) < 0)
+            nooc_error("include file '%s' not found", hdr);
+        return;
+    }
+
+    /* identifiers */
+    r.nb_map = pch_get_int(&r);
+    if (r.nb_map < 0 || r.nb_map > r.end - r.p)
+        goto bad;
+    r.map = nooc_malloc(r.nb_map * sizeof(int) + 1);
+    dynarray_add(&s1->pch_bufs, &s1->nb_pch_bufs, r.map);
+    for (i = 0; i < r.nb_map && !r.err; i++) {
+        const char *name = pch_get_str(&r);
+        r.map[i] = tok_alloc(name, strlen(name))->tok;
+    }
+
+    /* macros */
+    n = pch_get_int(&r);
+    while (--n >= 0 && !r.err) {
+        Sym *d;
+        v = pch_get_tok(&r);
+        t = pch_get_int(&r);
+        d = define_find(v);
+        if (t < 0) {
+            if (d)
+                define_undef(d);
+            continue;
+        }
+        first = NULL, ps = &first;
+        i = pch_get_int(&r);
+        while (--i >= 0 && !r.err) {
+            int a = pch_get_tok(&r);
+            *ps = sym_push2(&define_stack, a | SYM_FIELD, pch_get_int(&r), 0);
+            ps = &(*ps)->next;
+        }
+        str = pch_get_tokens(&r);
+        if (v < TOK_IDENT)
+            r.err = 1;
+        if (r.err)
+            break;
+        if (d && d->type.t == t && macro_is_equal(d->d, str))
+            continue;
+        size = (r.p - str) * sizeof(int);
+        define_push(v, t, memcpy(tal_realloc(tokstr_alloc, 0, size), str, size), first);
+    }
+
+    /* include guards and #pragma once */
+    n = pch_get_int(&r);
+    while (--n >= 0 && !r.err) {
+        const char *name;
+        v = pch_get_tok(&r);
+        t = pch_get_int(&r);
+        name = pch_get_str(&r);
+        if (r.err)
+            break;
+        if (stat(name, &sb))
+            sb.st_dev = sb.st_ino = 0;
+        e = cache_guard(s1, name, sb.st_dev, sb.st_ino);
+        if (v)
+            e->ifndef_macro = v;
+        if (t)
+            e->once = 1;
+    }
+
+    /* #pragma comment(lib) */
+    n = pch_get_int(&r);
+    while (--n >= 0 && !r.err)
+        dynarray_add(&s1->pragma_libs, &s1->nb_pragma_libs,
+            nooc_strdup(pch_get_str(&r)));
+
+    str = pch_get_tokens(&r);
+    if (r.err) {
+ bad:
+        pch_error("is a corrupted precompiled header");
+    }
+    if (bf->fd > 0)
+        close(bf->fd);
+    bf->fd = -1;
+    pstrcpy(bf->filename, sizeof bf->filename, hdr);
+    bf->pch_str = str;
+}
+
 /* ------------------------------------------------------------------------- */
 /* init preprocessor */
 
@@ -3625,7 +4323,6 @@ static void nooc_predefs(NOOCState *s1, CString *cs, int is_asm)
 #endif
         , -1);
     }
-    cstr_printf(cs, "#define __BASE_FILE__ \"%s\"\n", file->filename);
 }
 
 ST_FUNC void preprocess_start(NOOCState *s1, int filetype)
@@ -3650,8 +4347,14 @@ ST_FUNC void preprocess_start(NOOCState *s1, int filetype)
         CString cstr;
         cstr_new(&cstr);
         nooc_predefs(s1, &cstr, is_asm);
-        if (s1->cmdline_defs.size)
+        s1->pch_ctx = pch_hash(2166136261u ^ s1->dollars_in_identifiers,
+            cstr.data, cstr.size);
+        cstr_printf(&cstr, "#define __BASE_FILE__ \"%s\"\n", file->filename);
+        if (s1->cmdline_defs.size) {
           cstr_cat(&cstr, s1->cmdline_defs.data, s1->cmdline_defs.size);
+          s1->pch_ctx = pch_hash(s1->pch_ctx,
+            s1->cmdline_defs.data, s1->cmdline_defs.size);
+        }
         if (s1->cmdline_incl.size)
           cstr_cat(&cstr, s1->cmdline_incl.data, s1->cmdline_incl.size);
         //printf("%s\n", (char*)cstr.data);
@@ -3673,6 +4376,9 @@ ST_FUNC void preprocess_end(NOOCState *s1)
     macro_ptr = NULL;
     while (file)
         nooc_close();
+    if (pp_out.size && !s1->pp_digest)
+        pp_flush(s1); /* output up to an error */
+    cstr_reset(&pp_out);
     noocpp_delete(s1);
 }
 
@@ -3703,11 +4409,12 @@ ST_FUNC void noocpp_new(NOOCState *s)
     tal_new(&toksym_alloc, TOKSYM_TAL_LIMIT, TOKSYM_TAL_SIZE);
     tal_new(&tokstr_alloc, TOKSTR_TAL_LIMIT, TOKSTR_TAL_SIZE);
 
-    memset(hash_ident, 0, TOK_HASH_SIZE * sizeof(TokenSym *));
-    memset(s->cached_includes_hash, 0, sizeof s->cached_includes_hash);
+    hash_ident = nooc_mallocz(TOK_HASH_SIZE * sizeof(TokenSym *));
+    hash_ident_size = TOK_HASH_SIZE;
 
     cstr_new(&tokcstr);
     cstr_new(&cstr_buf);
+    cstr_new(&pp_out);
     cstr_realloc(&cstr_buf, STRING_MAX_SIZE);
     tok_str_new(&tokstr_buf);
     tok_str_realloc(&tokstr_buf, TOKSTR_MAX_SIZE);
@@ -3739,6 +4446,19 @@ ST_FUNC void noocpp_delete(NOOCState *s)
     int i, n;
 
     dynarray_reset(&s->cached_includes, &s->nb_cached_includes);
+    nooc_free(s->cached_includes_hash);
+    nooc_free(s->cached_ino_hash);
+    s->cached_includes_hash = NULL;
+    s->cached_ino_hash = NULL;
+    s->cached_includes_hash_size = 0;
+    dynarray_reset(&s->pch_bufs, &s->nb_pch_bufs);
+#if CONFIG_NOOC_MMAP
+    for (i = 0; i < s->nb_pch_maps; i += 2)
+        munmap(s->pch_maps[i], (size_t)s->pch_maps[i + 1]);
+#endif
+    nooc_free(s->pch_maps);
+    s->pch_maps = NULL;
+    s->nb_pch_maps = 0;
 
     /* free tokens */
     n = tok_ident - TOK_IDENT;
@@ -3748,11 +4468,17 @@ ST_FUNC void noocpp_delete(NOOCState *s)
         tal_free(toksym_alloc, table_ident[i]);
     nooc_free(table_ident);
     table_ident = NULL;
+    nooc_free(hash_ident);
+    hash_ident = NULL;
 
     /* free static buffers */
     cstr_free(&tokcstr);
     cstr_free(&cstr_buf);
+    cstr_free(&pp_out);
     tok_str_free_str(tokstr_buf.str);
+    for (i = 0; i < MACRO_CACHE_SIZE; i++)
+        tok_str_free_str(macro_cache[i].str);
+    memset(macro_cache, 0, sizeof macro_cache);
 
     /* free allocators */
     tal_delete(toksym_alloc);
@@ -3764,21 +4490,125 @@ ST_FUNC void noocpp_delete(NOOCState *s)
 /* ------------------------------------------------------------------------- */
 /* nooc -E [-P[1]] [-dD} support */
 
+/* The output is collected in pp_out and written (or hashed for
+   -digest) in large blocks rather than token by token. */
+#define PP_OUT_SIZE 65536
+
+/* SHA-256 for -digest */
+typedef struct Sha256 {
+    uint32_t h[8];
+    uint64_t len;
+    unsigned char buf[64];
+} Sha256;
+
+static ST_TLS Sha256 pp_sha;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR32(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+static void sha256_block(uint32_t *h, const unsigned char *p)
+{
+    uint32_t w[64], v[8], t1, t2;
+    int i;
+
+    for (i = 0; i < 16; i++, p += 4)
+        w[i] = (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    for (; i < 64; i++)
+        w[i] = w[i - 16] + w[i - 7]
+            + (ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ w[i - 15] >> 3)
+            + (ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ w[i - 2] >> 10);
+    memcpy(v, h, sizeof v);
+    for (i = 0; i < 64; i++) {
+        t1 = v[7] + (ROR32(v[4], 6) ^ ROR32(v[4], 11) ^ ROR32(v[4], 25))
+            + ((v[4] & v[5]) ^ (~v[4] & v[6])) + sha256_k[i] + w[i];
+        t2 = (ROR32(v[0], 2) ^ ROR32(v[0], 13) ^ ROR32(v[0], 22))
+            + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v + 1, v, 7 * sizeof *v);
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (i = 0; i < 8; i++)
+        h[i] += v[i];
+}
+
+static void sha256_init(Sha256 *c)
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(c->h, iv, sizeof iv);
+    c->len = 0;
+}
+
+static void sha256_update(Sha256 *c, const void *data, size_t n)
+{
+    const unsigned char *p = data;
+    unsigned r = c->len & 63, k;
+
+    c->len += n;
+    if (r) {
+        k = n < 64 - r ? n : 64 - r;
+        memcpy(c->buf + r, p, k);
+        if (r + k < 64)
+            return;
+        sha256_block(c->h, c->buf);
+        p += k, n -= k;
+    }
+    for (; n >= 64; p += 64, n -= 64)
+        sha256_block(c->h, p);
+    memcpy(c->buf, p, n);
+}
+
+/* write the digest as 64 hex digits to 'hex' */
+static void sha256_final(Sha256 *c, char *hex)
+{
+    unsigned char pad[72] = { 0x80 };
+    uint64_t bits = c->len * 8;
+    int i, n = ((c->len & 63) < 56 ? 56 : 120) - (c->len & 63);
+
+    for (i = 0; i < 8; i++)
+        pad[n + i] = bits >> (56 - 8 * i);
+    sha256_update(c, pad, n + 8);
+    for (i = 0; i < 32; i++)
+        sprintf(hex + 2 * i, "%02x", (c->h[i / 4] >> (24 - 8 * (i % 4))) & 255);
+}
+
+static void pp_flush(NOOCState *s1)
+{
+    if (s1->pp_digest)
+        sha256_update(&pp_sha, pp_out.data, pp_out.size);
+    else
+        fwrite(pp_out.data, 1, pp_out.size, s1->ppfp);
+    cstr_reset(&pp_out);
+}
+
 static void tok_print(const char *msg, const int *str)
 {
-    FILE *fp;
     int t, s = 0;
     CValue cval;
 
-    fp = nooc_state->ppfp;
-    fprintf(fp, "%s", msg);
+    cstr_printf(&pp_out, "%s", msg);
     while (str) {
 	TOK_GET(&t, &str, &cval);
 	if (!t)
 	    break;
-	fprintf(fp, &" %s"[s], get_tok_str(t, &cval)), s = 1;
+	cstr_printf(&pp_out, &" %s"[s], get_tok_str(t, &cval)), s = 1;
     }
-    fprintf(fp, "\n");
+    cstr_ccat(&pp_out, '\n');
 }
 
 static void pp_line(NOOCState *s1, BufferedFile *f, int level)
@@ -3792,11 +4622,11 @@ static void pp_line(NOOCState *s1, BufferedFile *f, int level)
         ;
     } else if (level == 0 && f->line_ref && d < 8) {
 	while (d > 0)
-	    fputs("\n", s1->ppfp), --d;
+	    cstr_ccat(&pp_out, '\n'), --d;
     } else if (s1->Pflag == LINE_MACRO_OUTPUT_FORMAT_STD) {
-	fprintf(s1->ppfp, "#line %d \"%s\"\n", f->line_num, f->filename);
+	cstr_printf(&pp_out, "#line %d \"%s\"\n", f->line_num, f->filename);
     } else {
-	fprintf(s1->ppfp, "# %d \"%s\"%s\n", f->line_num, f->filename,
+	cstr_printf(&pp_out, "# %d \"%s\"%s\n", f->line_num, f->filename,
 	    level > 0 ? " 1" : level < 0 ? " 2" : "");
     }
     f->line_ref = f->line_num;
@@ -3804,26 +4634,24 @@ static void pp_line(NOOCState *s1, BufferedFile *f, int level)
 
 static void define_print(NOOCState *s1, int v)
 {
-    FILE *fp;
     Sym *s;
 
     s = define_find(v);
     if (NULL == s || NULL == s->d)
         return;
 
-    fp = s1->ppfp;
-    fprintf(fp, "#define %s", get_tok_str(v, NULL));
+    cstr_printf(&pp_out, "#define %s", get_tok_str(v, NULL));
     if (s->type.t == MACRO_FUNC) {
         Sym *a = s->next;
-        fprintf(fp,"(");
+        cstr_ccat(&pp_out, '(');
         if (a)
             for (;;) {
-                fprintf(fp,"%s", get_tok_str(a->v & ~SYM_FIELD, NULL));
+                cstr_printf(&pp_out, "%s", get_tok_str(a->v & ~SYM_FIELD, NULL));
                 if (!(a = a->next))
                     break;
-                fprintf(fp,",");
+                cstr_ccat(&pp_out, ',');
             }
-        fprintf(fp,")");
+        cstr_ccat(&pp_out, ')');
     }
     tok_print("", s->d);
 }
@@ -3832,7 +4660,6 @@ static void pp_debug_defines(NOOCState *s1)
 {
     int v, t;
     const char *vs;
-    FILE *fp;
 
     t = pp_debug_tok;
     if (t == 0)
@@ -3842,17 +4669,16 @@ static void pp_debug_defines(NOOCState *s1)
     pp_line(s1, file, 0);
     file->line_ref = ++file->line_num;
 
-    fp = s1->ppfp;
     v = pp_debug_symv;
     vs = get_tok_str(v, NULL);
     if (t == TOK_DEFINE) {
         define_print(s1, v);
     } else if (t == TOK_UNDEF) {
-        fprintf(fp, "#undef %s\n", vs);
+        cstr_printf(&pp_out, "#undef %s\n", vs);
     } else if (t == TOK_push_macro) {
-        fprintf(fp, "#pragma push_macro(\"%s\")\n", vs);
+        cstr_printf(&pp_out, "#pragma push_macro(\"%s\")\n", vs);
     } else if (t == TOK_pop_macro) {
-        fprintf(fp, "#pragma pop_macro(\"%s\")\n", vs);
+        cstr_printf(&pp_out, "#pragma pop_macro(\"%s\")\n", vs);
     }
     pp_debug_tok = 0;
 }
@@ -3909,6 +4735,10 @@ ST_FUNC int nooc_preprocess(NOOCState *s1)
 	return 0;
     }
 
+    cstr_reset(&pp_out);
+    if (s1->pp_digest)
+        sha256_init(&pp_sha);
+
     if (s1->dflag & 1) {
         pp_debug_builtins(s1);
         s1->dflag &= ~1;
@@ -3951,10 +4781,19 @@ ST_FUNC int nooc_preprocess(NOOCState *s1)
             white[spcs++] = ' ';
         }
 
-        white[spcs] = 0, fputs(white, s1->ppfp), spcs = 0;
-        fputs(p = get_tok_str(tok, &tokc), s1->ppfp);
+        if (spcs)
+            cstr_cat(&pp_out, white, spcs), spcs = 0;
+        cstr_cat(&pp_out, p = get_tok_str(tok, &tokc), -1);
+        if (pp_out.size >= PP_OUT_SIZE)
+            pp_flush(s1);
         token_seen = pp_check_he0xE(tok, p);
     }
+    pp_flush(s1);
+    if (s1->pp_digest) {
+        char hex[65];
+        sha256_final(&pp_sha, hex);
+        fprintf(s1->ppfp, "%s  %s\n", hex, file->true_filename);
+    }
     return 0;
 }
 
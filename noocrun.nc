@@ -342,7 +342,9 @@ redo:
                     *(void**)mem = win64_add_function_table(s1);
 #endif
                 if (s->data) {
-                    nooc_free(s->data);
+                    if (!s->data_mapped)
+                        nooc_free(s->data);
+                    s->data_mapped = 0;
                     s->data = NULL;
                     s->data_allocated = 0;
                 }
@@ -31,6 +31,9 @@
 
 #define CHAR_IS_UNSIGNED
 
+#define NOOC_TARGET_JUMP_TABLE
+ST_FUNC void gen_jmp_table(int *tab, int n);
+
 #else
 #define USING_GLOBALS
 #include "nooc.h"
@@ -75,8 +78,8 @@ ST_DATA const int reg_classes[NB_REGS] = {
 };
 
 #if defined(CONFIG_NOOC_BCHECK)
-static addr_t func_bound_offset;
-static unsigned long func_bound_ind;
+static ST_TLS addr_t func_bound_offset;
+static ST_TLS unsigned long func_bound_ind;
 ST_DATA int func_bound_add_epilog;
 #endif
 
@@ -775,7 +778,7 @@ done:
    nooc_free(info);
 }
 
-static int func_sub_sp_offset, num_va_regs, func_va_list_ofs;
+static ST_TLS int func_sub_sp_offset, num_va_regs, func_va_list_ofs;
 
 ST_FUNC void gfunc_prolog(Sym *func_sym)
 {
@@ -1387,6 +1390,26 @@ ST_FUNC void ggoto(void)
     vtop--;
 }
 
+// Jump to tab[vtop], 0 <= vtop < n. tab[] holds code addresses, or -1
+// for the code after the table, which follows the jump as offsets from
+// its start.
+ST_FUNC void gen_jmp_table(int *tab, int n)
+{
+    int r = ireg(gv(RC_INT)), t, i;
+    vtop--;
+    o(0x17 | (5 << 7)); // auipc t0, 0
+    EI(0x13, 0, 5, 5, 32); // addi t0, t0, 32 (the table)
+    EI(0x13, 1, r, r, 32); // slli r, r, 32
+    EI(0x13, 5, r, r, 30); // srli r, r, 30
+    ER(0x33, 0, r, r, 5, 0); // add r, r, t0
+    EI(0x03, 2, r, r, 0); // lw r, 0(r)
+    ER(0x33, 0, r, r, 5, 0); // add r, r, t0
+    EI(0x67, 0, 0, r, 0); // jalr x0, 0(r)
+    t = ind;
+    for (i = 0; i < n; i++)
+        o((tab[i] < 0 ? t + 4 * n : tab[i]) - t);
+}
+
 ST_FUNC void gen_vla_sp_save(int addr)
 {
     if (((unsigned)addr + (1 << 11)) >> 12) {
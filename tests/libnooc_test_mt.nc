@@ -241,6 +241,42 @@ static unsigned getclock_ms(void)
 #endif
 }
 
+/* scaling benchmark: each of n threads compiles 'src' with its own state */
+const char *scale_src;
+
+TF_TYPE(thread_compile, vn)
+{
+    NOOCState *s;
+    int ret;
+
+    s = new_state(1);
+    ret = nooc_add_file(s, scale_src);
+    nooc_delete(s);
+    if (ret < 0)
+        exit(1);
+    return 0;
+}
+
+void scale_nooc(int max, const char *src)
+{
+    unsigned t, t1 = 0;
+    int n, i;
+
+    scale_src = src;
+    for (n = 1; n <= max; n *= 2) {
+        t = getclock_ms();
+        for (i = 0; i < n; ++i)
+            create_thread(thread_compile, i);
+        wait_threads(n);
+        t = getclock_ms() - t;
+        if (n == 1)
+            t1 = t;
+        /* ideally the time stays the same as the work grows with n */
+        printf(" %d: %u ms (%.1fx)", n, t, t ? (double)t1 * n / t : (double)n);
+        fflush(stdout);
+    }
+}
+
 int main(int argc, char **argv)
 {
     int n;
@@ -281,6 +317,11 @@ int main(int argc, char **argv)
     t = getclock_ms();
     time_nooc(10, argv[1]);
     printf("\n (%u ms)\n", getclock_ms() - t), fflush(stdout);
+#endif
+#if 1
+    printf("compiling nooc.c in 1..16 threads at once (speedup)\n "), fflush(stdout);
+    scale_nooc(16, argv[1]);
+    printf("\n"), fflush(stdout);
 #endif
     return 0;
 }
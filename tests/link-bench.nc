@@ -0,0 +1,42 @@
+/* an object with some 600000 relocations, to time the linker
+   applying them, see 'make linkbench' */
+
+#include <stdio.h>
+
+#define T4 f, g, f, g,
+#define T64 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4
+#define T1K T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64
+#define T16K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K
+#define C1 i = f(g(i) ^ 0x55) + (i >> 3);
+#define C4 C1 C1 C1 C1
+#define C64 C4 C4 C4 C4 C4 C4 C4 C4 C4 C4 C4 C4 C4 C4 C4 C4
+#define C1K C64 C64 C64 C64 C64 C64 C64 C64 C64 C64 C64 C64 C64 C64 C64 C64
+
+static int f(int i) { return i + 1; }
+static int g(int i) { return i * 3; }
+
+/* one absolute relocation per entry */
+int (*table[])(int) = {
+    T16K T16K T16K T16K T16K T16K T16K T16K
+    T16K T16K T16K T16K T16K T16K T16K T16K
+    T16K T16K T16K T16K T16K T16K T16K T16K
+    T16K T16K T16K T16K T16K T16K T16K T16K
+};
+
+/* two pc-relative relocations per line */
+static int calls(int i)
+{
+    C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K
+    C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K C1K
+    return i;
+}
+
+int main(void)
+{
+    unsigned i, n = sizeof table / sizeof *table, acc = 0;
+
+    for (i = 0; i < n; ++i)
+        acc = acc * 7 + table[i](i);
+    printf("%u entries, %08x %08x\n", n, acc, (unsigned)calls(1));
+    return 0;
+}
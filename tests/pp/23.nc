@@ -0,0 +1,27 @@
+#define ONE 1
+#define TWO (ONE + ONE)
+#define FOUR (TWO * TWO)
+#define CALL f(FOUR)
+#define f(x) [x]
+#define LINE ONE __LINE__
+#define OPEN g ONE
+#define g(x) <x>
+#define SELF SELF + FOUR
+A FOUR FOUR CALL CALL
+B LINE
+C LINE
+D OPEN (2) OPEN (3) OPEN
+E SELF SELF
+#undef ONE
+#define ONE one
+F FOUR CALL
+#undef f
+#define f(x) {x}
+G CALL CALL f(CALL)
+#undef ONE
+H FOUR
+#define ONE 1
+I FOUR
+#define t(a) a
+#define G f
+J t(G) (0) G(5) t(G)
@@ -0,0 +1,13 @@
+/* 'make bench' preprocesses this followed by many lines that use DEEP,
+   which expands 2^8 nested macros. */
+#define ADD(a, b) a + b
+#define C0 1
+#define C1 ADD(C0, C0)
+#define C2 ADD(C1, C1)
+#define C3 ADD(C2, C2)
+#define C4 ADD(C3, C3)
+#define C5 ADD(C4, C4)
+#define C6 ADD(C5, C5)
+#define C7 ADD(C6, C6)
+#define C8 ADD(C7, C7)
+#define DEEP (C8)
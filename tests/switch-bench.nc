@@ -0,0 +1,43 @@
+/* dispatch loop of a bytecode interpreter with a dense 200 case
+   switch, see 'make switchbench' */
+
+#include <stdio.h>
+
+#define OP(n) case n: acc = acc * 31 + n + (acc >> 7); break;
+#define OP10(n) OP(n##0) OP(n##1) OP(n##2) OP(n##3) OP(n##4) \
+                OP(n##5) OP(n##6) OP(n##7) OP(n##8) OP(n##9)
+
+#define CODE_SIZE 4096
+
+static unsigned run(const unsigned char *code, unsigned acc)
+{
+    const unsigned char *end = code + CODE_SIZE;
+
+    while (code < end) {
+        switch (*code++) {
+        OP(0) OP(1) OP(2) OP(3) OP(4) OP(5) OP(6) OP(7) OP(8) OP(9)
+        OP10(1) OP10(2) OP10(3) OP10(4) OP10(5)
+        OP10(6) OP10(7) OP10(8) OP10(9) OP10(10)
+        OP10(11) OP10(12) OP10(13) OP10(14) OP10(15)
+        OP10(16) OP10(17) OP10(18) OP10(19)
+        default: acc ^= 0x5555; break;
+        }
+    }
+    return acc;
+}
+
+int main(int argc, char **argv)
+{
+    static unsigned char code[CODE_SIZE];
+    unsigned acc = 1, seed = 12345;
+    int i;
+
+    for (i = 0; i < CODE_SIZE; i++) {
+        seed = seed * 1103515245 + 12345;
+        code[i] = (seed >> 16) % 210;
+    }
+    for (i = 0; i < 20000; i++)
+        acc = run(code, acc);
+    printf("%u\n", acc);
+    return 0;
+}
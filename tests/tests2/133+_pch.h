@@ -0,0 +1,28 @@
+/* header for 133_pch.nc, made into 133.nch first */
+#ifndef PCH_133_H
+#define PCH_133_H
+
+#include <stdio.h>
+#include <string.h>
+
+#define SQUARE(x) ((x) * (x))
+#define SHOW(fmt, ...) printf(fmt "\n", __VA_ARGS__)
+#define CAT(a, b) a ## b
+#define NAME "pch"
+#define TEMP 1
+#undef TEMP
+
+typedef struct { int a, b; } pair;
+enum color { RED, GREEN = 5, BLUE };
+
+static inline int sum(pair p)
+{
+    return p.a + p.b;
+}
+
+static const char *where(void)
+{
+    return __FILE__;
+}
+
+#endif
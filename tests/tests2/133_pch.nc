@@ -0,0 +1,21 @@
+/* the Makefile compiles this with -include 133.nch */
+#include "133+_pch.h"
+#include <stdio.h>
+
+int main(void)
+{
+    pair p = { 3, 4 };
+    int CAT(x, 1) = SQUARE(sum(p));
+    char buf[16];
+
+    strcpy(buf, NAME);
+    SHOW("%s %d %d %d", buf, x1, GREEN, BLUE);
+    SHOW("%s line %d", where(), __LINE__);
+#ifdef TEMP
+    puts("TEMP defined");
+#endif
+#ifdef PCH_133_H
+    puts("guard defined");
+#endif
+    return 0;
+}
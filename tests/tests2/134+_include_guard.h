@@ -0,0 +1,4 @@
+#ifndef GUARD_134
+#define GUARD_134 1
+static int guard_134 = GUARD_134;
+#endif
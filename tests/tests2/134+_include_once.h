@@ -0,0 +1,6 @@
+#pragma once
+#ifdef ONCE_134
+#error read twice
+#endif
+#define ONCE_134 1
+struct once { int x; };
@@ -0,0 +1 @@
+/root/repo/tests/tests2/134+_include_guard.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/tests/tests2/134+_include_once.h
\ No newline at end of file
@@ -0,0 +1,24 @@
+/* a guarded header reached by different paths is read only once */
+#ifndef ONLY_134
+#include <stdio.h>
+#endif
+#include "134+_include_guard.h"
+#include "./134+_include_guard.h"
+#include "../tests2/134+_include_guard.h"
+#include "134+_include_once.h"
+#include "./134+_include_once.h"
+#include "../tests2/134+_include_once.h"
+#ifdef LINKS_134
+/* symbolic links made by the Makefile: only the inode tells */
+#include "134-link_guard.h"
+#include "134-link_once.h"
+#endif
+
+#ifndef ONLY_134
+int main(void)
+{
+    struct once o = { 1 };
+    printf("guard %d, once %d\n", guard_134, o.x + ONCE_134 - 1);
+    return 0;
+}
+#endif
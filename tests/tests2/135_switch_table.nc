@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <limits.h>
+
+/* dense switches are compiled to a jump table */
+
+int dense(int x)
+{
+    switch (x) {
+    case -3: return 1;
+    case -2: return 2;
+    case -1: return 3;
+    case 0: return 4;
+    case 2: return 5;
+    case 3: return 6;
+    case 4 ... 6: return 7;
+    default: return 0;
+    }
+}
+
+int nodefault(unsigned x)
+{
+    int r = 100;
+    switch (x) {
+    case 10: r = 1; break;
+    case 11: r = 2; /* fall through */
+    case 12: r += 3; break;
+    case 14: r = 4; break;
+    case 15: r = 5; break;
+    case 17: r = 6; break;
+    }
+    return r;
+}
+
+int top(unsigned x)
+{
+    switch (x) {
+    case UINT_MAX - 5: return 1;
+    case UINT_MAX - 4: return 2;
+    case UINT_MAX - 3: return 3;
+    case UINT_MAX - 1: return 4;
+    case UINT_MAX: return 5;
+    default: return 0;
+    }
+}
+
+int wide(long long x)
+{
+    switch (x) {
+    case LLONG_MIN: return 1;
+    case LLONG_MIN + 1: return 2;
+    case LLONG_MIN + 2: return 3;
+    case LLONG_MIN + 3: return 4;
+    case LLONG_MIN + 5: return 5;
+    default: return 0;
+    }
+}
+
+int sparse(int x)
+{
+    switch (x) {
+    case 1: return 1;
+    case 100: return 2;
+    case 1000: return 3;
+    case 10000: return 4;
+    case 100000: return 5;
+    case 1000000: return 6;
+    default: return 0;
+    }
+}
+
+int run(const unsigned char *code)
+{
+    int acc = 0, n = 0;
+    for (;;) {
+        switch (*code++) {
+        case 0: return acc;
+        case 1: acc++; break;
+        case 2: acc--; break;
+        case 3: acc *= 2; break;
+        case 4: acc = -acc; break;
+        case 5: n = acc; break;
+        case 6: acc += n; break;
+        case 7: if (acc > 100) continue; acc *= 3; break;
+        default: acc = 999; break;
+        }
+    }
+}
+
+int main(void)
+{
+    static const unsigned char prog[] = { 1, 1, 3, 5, 6, 7, 7, 7, 4, 2, 8, 9, 1, 0 };
+    long long ll[] = { LLONG_MIN, LLONG_MIN + 3, LLONG_MIN + 4, LLONG_MIN + 5,
+                       LLONG_MIN + 6, LLONG_MAX, 0, -1 };
+    int i;
+
+    for (i = -6; i <= 9; i++)
+        printf("%d", dense(i));
+    printf(" %d %d\n", dense(INT_MIN), dense(INT_MAX));
+    for (i = 8; i <= 19; i++)
+        printf("%d ", nodefault(i));
+    printf("%d\n", nodefault(-1));
+    for (i = 7; i >= -1; i--)
+        printf("%d", top(UINT_MAX - i));
+    printf("\n");
+    for (i = 0; i < 8; i++)
+        printf("%d", wide(ll[i]));
+    printf("\n");
+    printf("%d%d%d%d\n", sparse(1), sparse(1000), sparse(1000000), sparse(2));
+    printf("%d\n", run(prog));
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <string.h>
+
+/* -O1 keeps scalar locals that are used in loops in registers */
+
+static void bump(int *p)
+{
+    ++*p;
+}
+
+/* more candidates than registers */
+static long many(int n)
+{
+    int a = 0, b = 1, c = 2, d = 3, e = 4, f = 5, g = 6, i;
+    long s = 0;
+
+    for (i = 0; i < n; i++) {
+        a += i; b ^= a; c += b & 7; d -= c;
+        e += d >> 3; f |= e; g += f & 15;
+        s += a + b + c + d + e + f + g;
+    }
+    return s;
+}
+
+/* narrow types must wrap and extend as in memory */
+static void narrow(void)
+{
+    signed char sc = 120;
+    unsigned char uc = 250;
+    short ss = 32760;
+    unsigned short us = 65530;
+    _Bool b = 0;
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        sc++; uc++; ss++; us++;
+        b = !b;
+    }
+    printf("%d %d %d %d %d\n", sc, uc, ss, us, b);
+    for (i = 0; i < 10; i++)
+        sc -= 30, uc += 100, ss *= 3, us <<= 1;
+    printf("%d %d %d %d\n", sc, uc, ss, us);
+}
+
+/* a local whose address is taken stays in memory */
+static int addressed(int n)
+{
+    int i, k = 0, sum = 0;
+
+    for (i = 0; i < n; i++) {
+        bump(&k);
+        sum += k;
+    }
+    for (i = 0; i < n; i++)
+        bump((&(sum)));
+    return sum + k;
+}
+
+/* registers survive calls and recursion */
+static int fib(int n)
+{
+    int i, r = 0;
+
+    if (n < 2)
+        return n;
+    for (i = 1; i <= 2; i++)
+        r += fib(n - i);
+    return r;
+}
+
+static unsigned hash(const char *s, unsigned h)
+{
+    while (*s)
+        h = h * 33 + *s++;
+    return h;
+}
+
+/* a #pragma pack in the body still applies to the structs declared
+   there */
+static int packed(void)
+{
+    int i, n = 0;
+#pragma pack(push, 1)
+    struct p { char c; int i; } a[4];
+#pragma pack(pop)
+    struct q { char c; int i; } b[4];
+
+    for (i = 0; i < 4; i++)
+        n += sizeof a[i] + sizeof b[i];
+    return n;
+}
+
+static unsigned long long wide(unsigned long long x, int n)
+{
+    unsigned long long r = 1;
+
+    while (n--)
+        r = r * x + (r >> 40);
+    return r;
+}
+
+int main(void)
+{
+    char buf[32];
+    int i, total = 0;
+    char *p;
+
+    printf("%ld\n", many(1000));
+    narrow();
+    printf("%d\n", addressed(10));
+    printf("%d\n", fib(20));
+    printf("%u\n", hash("register variables", 5381));
+    printf("%d\n", packed());
+    printf("%llu\n", wide(3, 50));
+
+    strcpy(buf, "pointer walk");
+    for (p = buf, i = 0; *p; p++, i++)
+        total += *p * i;
+    printf("%d %d\n", total, (int)(p - buf));
+    return 0;
+}
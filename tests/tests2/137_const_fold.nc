@@ -0,0 +1,48 @@
+#include <stdio.h>
+
+/* const integer variables with a constant initializer are folded
+   into the code that reads them */
+
+static const int size = 4;
+static const unsigned char mask = 0xf0;
+static const short neg = -3;
+static const long long big = 0x123456789LL;
+static const int debug = 0;
+const unsigned limit = 4000000000u;
+
+static int twice(int x)
+{
+    static const int factor = 2;
+    return x * factor;
+}
+
+static int count(void)
+{
+    const int n = 3;
+    const char c = -1;
+    int i, s = 0;
+
+    for (i = 0; i < n; i++)
+        s += c;
+    return s;
+}
+
+int main(void)
+{
+    const int k = 7;
+    const int *p = &k;
+    int a[size];
+    int i;
+
+    for (i = 0; i < size; i++)
+        a[i] = i * k;
+    printf("%d %d %d %d\n", a[0], a[1], a[2], a[3]);
+    printf("%d %d %lld %u\n", mask, neg, big, limit);
+    printf("%d %d %d\n", *p, twice(21), count());
+    printf("%d\n", mask >> 4 | neg << 8);
+    if (debug)
+        printf("not reached\n");
+    printf("%d\n", debug ? 1 : size * k);
+    printf("%d\n", (int)(&size != 0));
+    return 0;
+}
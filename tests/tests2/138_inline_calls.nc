@@ -0,0 +1,103 @@
+#include <stdio.h>
+
+/* -finline-functions expands the calls of small static functions */
+
+struct pt { int x, y; };
+
+static int counter = 10;
+
+static inline int max(int a, int b) { return a > b ? a : b; }
+static int sq(int x) { return x * x; }
+static double half(double d) { return d / 2; }
+static long double third(long double d) { return d / 3; }
+static struct pt mkpt(int x, int y) { struct pt p; p.x = x; p.y = y; return p; }
+static int sum(struct pt p) { return p.x + p.y; }
+static void swap(int *a, int *b) { int t = *a; *a = *b; *b = t; }
+static int get_counter(void) { return counter; }
+static void bump(void) { counter++; }
+static unsigned char low(int x) { return x; }
+static const char *name(void) { return __func__; }
+
+static int sign(int x)
+{
+    if (x < 0)
+        return -1;
+    if (x > 0)
+        return 1;
+    return 0;
+}
+
+static void clamp(int *p, int lo, int hi)
+{
+    if (*p < lo) {
+        *p = lo;
+        return;
+    }
+    if (*p > hi)
+        *p = hi;
+}
+
+static int kind(int c)
+{
+    switch (c) {
+    case '0' ... '9': return 1;
+    case ' ': return 2;
+    default: return 0;
+    }
+}
+
+static int count_bits(unsigned x)
+{
+    int n = 0;
+    while (x) {
+        if (!(x & 1)) {
+            x >>= 1;
+            continue;
+        }
+        n++, x >>= 1;
+    }
+    return n;
+}
+
+/* recursive: inlined once into its callers only */
+static int fact(int n) { return n <= 1 ? 1 : n * fact(n - 1); }
+
+int main(void)
+{
+    int a = 3, b = 4, x = -7, i, s = 0;
+    int counter = 100; /* hides the global from main, not from get_counter() */
+    struct pt p = mkpt(5, 6);
+    int (*fp)(int) = sq;
+    const char *str = "a1 b22 c";
+
+    swap(&a, &b);
+    printf("%d %d\n", a, b);
+    swap(&b, &a);
+    printf("%d %d %d\n", a, b, max(b, a));
+
+    for (i = -3; i < 10; i++)
+        s += sq(i) + max(i, 5) + sign(i);
+    printf("%d\n", s);
+
+    printf("%g %Lg %d %d\n", half(5), third(9), sum(p), sum(mkpt(1, 2)));
+    bump(), bump();
+    printf("%d %d\n", get_counter(), counter);
+    printf("%d %d\n", low(0x1234), low(-1));
+    printf("%s %d %d\n", name(), fact(6), fp(9));
+
+    clamp(&x, 0, 5);
+    printf("%d\n", x);
+    x = 17;
+    clamp(&x, 0, 5);
+    printf("%d\n", x);
+
+    for (s = 0; *str; str++)
+        s = s * 3 + kind(*str);
+    printf("%d %d\n", s, count_bits(0xf0f0));
+
+    /* nested and in conditions */
+    printf("%d\n", max(sq(3), sq(max(2, sign(-4) + 5))));
+    if (sq(a) > 5 && max(a, b) == 4)
+        printf("yes %d\n", a < b ? sq(b) : sq(a));
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdint.h>
+
+/* division, modulo and multiplication by constants against the same
+   operations on a variable, for signed and unsigned 32 and 64 bits:
+   every dividend around 0 and the limits, and random ones */
+
+#define SMALL(X) \
+    X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) \
+    X(14) X(15) X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) \
+    X(25) X(27) X(31) X(32) X(33) X(36) X(37) X(40) X(45) X(60) X(63) \
+    X(64) X(65) X(81) X(100) X(125) X(127) X(128) X(255) X(641) \
+    X(1000) X(1023) X(1025) X(10000) X(65535) X(65536) X(65537) \
+    X(1000000) X(6700417) X(0x40000000) X(0x40000001) X(0x7ffffffe) \
+    X(0x7fffffff)
+
+#define NEG(X) \
+    X(-2) X(-3) X(-5) X(-7) X(-8) X(-10) X(-16) X(-25) X(-100) X(-641) \
+    X(-65536) X(-1000000) X(-0x40000000) X(-0x7fffffff)
+
+#define U32(X) \
+    X(0x80000000u) X(0x80000001u) X(0xaaaaaaabu) X(0xc0000000u) \
+    X(0xfffffffeu) X(0xffffffffu)
+
+#define S64(X) \
+    X(1000000000ll) X(0x100000001ll) X(3ll << 40) X(10000000000000ll) \
+    X(1000000000000000000ll) X(0x4000000000000000ll) \
+    X(0x7fffffffffffffffll) X(-1000000007ll) X(-0x4000000000000000ll) \
+    X(-0x7fffffffffffffffll - 1)
+
+#define U64(X) \
+    X(0x8000000000000000ull) X(0x8000000000000001ull) \
+    X(0xaaaaaaaaaaaaaaabull) X(0xfffffffffffffffeull)
+
+#define TEST(name, type, utype, LIST)                                   \
+static volatile type name##_v;                                          \
+static int name##_errors;                                               \
+static utype name##_sum;                                                \
+static void name##_check(type x)                                        \
+{                                                                       \
+    type q, r;                                                          \
+    LIST(CHECK)                                                         \
+}
+
+#define CHECK_OP(x, d, v)                                               \
+    v = (d);                                                            \
+    q = x / (d), r = x % (d);                                           \
+    if (q != x / v || r != x % v                                        \
+        || (utype_of_x)x * (utype_of_x)(d) != (utype_of_x)x * (utype_of_x)v) \
+        errors++;                                                       \
+    sum = sum * 31 + q + r;
+
+#define REPORT(name) \
+    printf("%s: %d errors, hash %llx\n", #name, name##_errors, \
+           (unsigned long long)name##_sum)
+
+/* one check function per type; 'CHECK' is redefined for each */
+#define utype_of_x uint32_t
+#define errors s32_errors
+#define sum s32_sum
+#define CHECK(d) CHECK_OP(x, d, s32_v)
+TEST(s32, int32_t, uint32_t, SMALL)
+#define CHECKN(d) CHECK_OP(x, d, s32_v)
+static void s32n_check(int32_t x)
+{
+    int32_t q, r;
+    NEG(CHECKN)
+}
+#undef CHECK
+#undef errors
+#undef sum
+
+#define errors u32_errors
+#define sum u32_sum
+#define CHECK(d) CHECK_OP(x, d, u32_v)
+TEST(u32, uint32_t, uint32_t, SMALL)
+#define CHECKU(d) CHECK_OP(x, d, u32_v)
+static void u32u_check(uint32_t x)
+{
+    uint32_t q, r;
+    U32(CHECKU)
+}
+#undef CHECK
+#undef errors
+#undef sum
+#undef utype_of_x
+
+#define utype_of_x uint64_t
+#define errors s64_errors
+#define sum s64_sum
+#define CHECK(d) CHECK_OP(x, d, s64_v)
+TEST(s64, int64_t, uint64_t, SMALL)
+#define CHECKL(d) CHECK_OP(x, d, s64_v)
+static void s64l_check(int64_t x)
+{
+    int64_t q, r;
+    NEG(CHECKL)
+    S64(CHECKL)
+}
+#undef CHECK
+#undef errors
+#undef sum
+
+#define errors u64_errors
+#define sum u64_sum
+#define CHECK(d) CHECK_OP(x, d, u64_v)
+TEST(u64, uint64_t, uint64_t, SMALL)
+#define CHECKUL(d) CHECK_OP(x, d, u64_v)
+static void u64ul_check(uint64_t x)
+{
+    uint64_t q, r;
+    U32(CHECKUL)
+    S64(CHECKUL)
+    U64(CHECKUL)
+}
+#undef CHECK
+#undef errors
+#undef sum
+
+static uint64_t seed = 1;
+
+static uint64_t rnd(void)
+{
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return seed ^ seed >> 29;
+}
+
+static void check32(uint32_t x)
+{
+    s32_check(x), s32n_check(x), u32_check(x), u32u_check(x);
+}
+
+static void check64(uint64_t x)
+{
+    s64_check(x), s64l_check(x), u64_check(x), u64ul_check(x);
+}
+
+int main(void)
+{
+    int i;
+
+    for (i = -3000; i <= 3000; i++) {
+        check32(i), check32(0x7fffffff + i), check32(0xffffffff - i);
+        check64(i), check64(0x7fffffffffffffffull + i);
+        check64(0xffffffffull + i), check64(0xffffffffffffffffull - i);
+    }
+    for (i = 0; i < 20000; i++) {
+        uint64_t x = rnd();
+        check32(x), check32(x >> (x & 31)), check64(x), check64(x >> (x & 63));
+    }
+    REPORT(s32);
+    REPORT(u32);
+    REPORT(s64);
+    REPORT(u64);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string.h>
+
+/* leaf functions: no frame, locals in the red zone below %rsp, and
+   the code which still moves %rsp in a leaf function */
+
+int g = 42;
+
+int get(void) { return g; }
+
+void set(void) { g++; }
+
+int add(int a, int b) { return a + b; }
+
+int fill(int n)
+{
+    int a[28], i, s = 0; /* 120 bytes */
+    for (i = 0; i < 28; i++)
+        a[i] = i * n;
+    for (i = 0; i < 28; i++)
+        s += a[i];
+    return s + a[n];
+}
+
+int fill_big(int n)
+{
+    int a[40], i, s = 0; /* more than the red zone */
+    for (i = 0; i < 40; i++)
+        a[i] = i * n;
+    for (i = 0; i < 40; i++)
+        s += a[i];
+    return s + a[n];
+}
+
+/* pushes below %rsp.  gcc keeps 'a' in the red zone here, the
+   .expect has the sum that it should print */
+int with_asm(int n)
+{
+    int a[8], i, s = 0;
+    for (i = 0; i < 8; i++)
+        a[i] = i + n;
+#if defined __x86_64__ || defined __i386__
+    __asm__ __volatile__("push %%rax\n\tpush %%rax\n\tpop %%rax\n\tpop %%rax"
+                         ::: "memory");
+#endif
+    for (i = 0; i < 8; i++)
+        s += a[i];
+    return s;
+}
+
+long double to_ld(int n, double d)
+{
+    int a[4] = { n, n + 1, n + 2, n + 3 };
+    long double x = n;
+    long double y = d;
+    float f = (float)x;
+    return x + y + f + a[0] + a[1] + a[2] + a[3];
+}
+
+int vla(int n)
+{
+    int b[4] = { 1, 2, 3, 4 };
+    int a[n], i, s = 0;
+    for (i = 0; i < n; i++)
+        a[i] = i;
+    for (i = 0; i < n; i++)
+        s += a[i];
+    return s + b[0] + b[3];
+}
+
+struct pt { long x, y, z; };
+
+struct pt mkpt(long x)
+{
+    struct pt p = { x, x * 2, x * 3 };
+    return p;
+}
+
+int rec(int n)
+{
+    char buf[16];
+    memset(buf, n, sizeof buf);
+    return n ? rec(n - 1) + buf[3] : 0;
+}
+
+int main(void)
+{
+    int (*fp)(int, int) = add;
+    struct pt p;
+
+    set();
+    printf("%d %d %d\n", get(), add(3, 4), fp(5, 6));
+    printf("%d %d\n", fill(5), fill_big(7));
+    printf("%d\n", with_asm(10));
+    printf("%.1Lf\n", to_ld(3, 0.5));
+    printf("%d\n", vla(10));
+    p = mkpt(5);
+    printf("%ld %ld %ld\n", p.x, p.y, p.z);
+    printf("%d\n", rec(10));
+    return 0;
+}
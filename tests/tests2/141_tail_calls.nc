@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdarg.h>
+
+/* calls in return position with -foptimize-sibling-calls.  The deep
+   ones would overflow the stack if they were made as usual. */
+
+#define DEEP 10000000
+
+long count(long n, long acc)
+{
+    if (n == 0)
+        return acc;
+    return count(n - 1, acc + n % 7);
+}
+
+int is_odd(unsigned n);
+
+int is_even(unsigned n)
+{
+    if (n == 0)
+        return 1;
+    return is_odd(n - 1);
+}
+
+int is_odd(unsigned n)
+{
+    if (n == 0)
+        return 0;
+    return is_even(n - 1);
+}
+
+double dsum(int n, double acc)
+{
+    if (!n)
+        return acc;
+    return dsum(n - 1, acc + 0.5);
+}
+
+/* a state machine through a function pointer */
+typedef int (*state)(const char *s, int n);
+int st_a(const char *s, int n);
+int st_b(const char *s, int n);
+
+int st_a(const char *s, int n)
+{
+    state next = *s == 'b' ? st_b : st_a;
+    if (!*s)
+        return n;
+    return next(s + 1, n + 1);
+}
+
+int st_b(const char *s, int n)
+{
+    state next = *s == 'a' ? st_a : st_b;
+    if (!*s)
+        return n * 2;
+    return next(s + 1, n + 10);
+}
+
+/* not in return position, or not the whole return expression */
+int inc(int x) { return x + 1; }
+int not_tail(int x) { return inc(x) + 1; }
+int not_tail2(int x) { return inc(x), inc(x + 10); }
+int not_tail3(int x) { return x ? inc(x) : inc(-x); }
+
+/* the callee sees locals of the caller: called as usual */
+int peek(int *p) { return *p + 1; }
+int with_addr(int x) { int y = x * 2; return peek(&y); }
+int sum_arr(int *a, int n) { return n ? a[0] + sum_arr(a + 1, n - 1) : 0; }
+int with_arr(int n) { int a[4] = { n, n, n, n }; return sum_arr(a, 4); }
+
+/* needs stack arguments: called as usual */
+long many(long a, long b, long c, long d, long e, long f, long g, long h)
+{
+    return a + b + c + d + e + f + g + h;
+}
+long call_many(long x) { return many(x, x, x, x, x, x, x, x); }
+
+/* variadic callee */
+int vsum(int n, ...)
+{
+    va_list ap;
+    int s = 0;
+    va_start(ap, n);
+    while (n--)
+        s += va_arg(ap, int);
+    va_end(ap);
+    return s;
+}
+int call_vsum(int x) { return vsum(3, x, x + 1, x + 2); }
+
+/* char results are promoted after the call */
+signed char sc(int x) { return (signed char)x; }
+signed char call_sc(int x) { return sc(x); }
+
+void vcount(long n, long *p)
+{
+    if (n == 0)
+        return;
+    *p += 1;
+    return vcount(n - 1, p);
+}
+
+int main(void)
+{
+    long n = 0;
+
+    printf("%ld\n", count(DEEP, 0));
+    printf("%d %d\n", is_even(DEEP), is_odd(DEEP + 1));
+    printf("%.1f\n", dsum(DEEP, 0));
+    printf("%d\n", st_a("aabbbaabab", 0));
+    printf("%d %d %d %d\n", not_tail(1), not_tail2(1), not_tail3(1), not_tail3(0));
+    printf("%d %d\n", with_addr(5), with_arr(3));
+    printf("%ld %d %d\n", call_many(2), call_vsum(4), call_sc(300));
+    vcount(DEEP, &n);
+    printf("%ld\n", n);
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <string.h>
+
+/* struct copies, memcpy() and memset() of constant sizes and zero
+   initialization, expanded into moves: every size up to the vector
+   limit and past it, with the bytes around the block checked too */
+
+static unsigned char buf[2048], ref[2048];
+static int errors;
+
+static void fill(unsigned char *p, int n, int seed)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        p[i] = (unsigned char)(i * 7 + seed);
+}
+
+static void check(const char *what, int size)
+{
+    if (memcmp(buf, ref, sizeof buf)) {
+        printf("%s %d failed\n", what, size);
+        errors++;
+    }
+}
+
+static void byte_copy(unsigned char *d, const unsigned char *s, int n)
+{
+    while (n--)
+        *d++ = *s++;
+}
+
+static void byte_set(unsigned char *d, int c, int n)
+{
+    while (n--)
+        *d++ = c;
+}
+
+#define SIZES(X) \
+    X(1) X(2) X(3) X(4) X(5) X(7) X(8) X(9) X(12) X(15) X(16) X(17) \
+    X(24) X(31) X(32) X(33) X(47) X(48) X(63) X(64) X(65) X(100) \
+    X(127) X(128) X(129) X(255) X(256) X(257) X(300) X(511) X(512) \
+    X(513) X(600)
+
+/* through pointers in registers */
+#define COPY(n)                                                 \
+    fill(buf, sizeof buf, n); fill(ref, sizeof ref, n);         \
+    memcpy(buf + 3, buf + 1000, n);                             \
+    byte_copy(ref + 3, ref + 1000, n);                          \
+    check("memcpy", n);                                         \
+    if (memcpy(buf + 1, buf + 1300, n) != buf + 1)              \
+        printf("memcpy %d result\n", n);                        \
+    byte_copy(ref + 1, ref + 1300, n);                          \
+    check("memcpy", n);
+
+#define SET(n)                                                  \
+    fill(buf, sizeof buf, n); fill(ref, sizeof ref, n);         \
+    memset(buf + 5, 0, n);                                      \
+    byte_set(ref + 5, 0, n);                                    \
+    check("memset 0", n);                                       \
+    if (memset(buf + 2, 0x1ab, n) != buf + 2)                   \
+        printf("memset %d result\n", n);                        \
+    byte_set(ref + 2, 0xab, n);                                 \
+    check("memset ab", n);                                      \
+    memset(buf + 9, -1, n);                                     \
+    byte_set(ref + 9, 255, n);                                  \
+    check("memset -1", n);
+
+/* struct assignment and zero initialization of locals */
+#define STRUCT(n)                                               \
+    {                                                           \
+        struct s##n { unsigned char a[n]; };                    \
+        struct s##n x, y, z = { { 1 } };                        \
+        unsigned char guard[16];                                \
+        fill(x.a, n, n); fill(y.a, n, 3); fill(guard, 16, 9);   \
+        y = x;                                                  \
+        if (memcmp(y.a, x.a, n))                                \
+            printf("struct %d failed\n", n), errors++;          \
+        x = *(struct s##n *)(buf + 1);                          \
+        if (memcmp(x.a, buf + 1, n))                            \
+            printf("struct load %d failed\n", n), errors++;     \
+        *(struct s##n *)(buf + 3) = y;                          \
+        if (memcmp(buf + 3, y.a, n))                            \
+            printf("struct store %d failed\n", n), errors++;    \
+        byte_set(ref, 0, n); ref[0] = 1;                        \
+        if (memcmp(z.a, ref, n))                                \
+            printf("struct init %d failed\n", n), errors++;     \
+        for (i = 0; i < 16; i++)                                \
+            if (guard[i] != (unsigned char)(i * 7 + 9))         \
+                printf("struct %d guard\n", n), errors++;       \
+    }
+
+/* a variable byte or size is still a call */
+static void *my_memcpy(void *d, const void *s, size_t n)
+{
+    return memcpy(d, s, n);
+}
+
+int main(void)
+{
+    int i, c = 0x55;
+
+    SIZES(COPY)
+    SIZES(SET)
+    SIZES(STRUCT)
+
+    fill(buf, sizeof buf, 1); fill(ref, sizeof ref, 1);
+    memset(buf + 7, c, 40);
+    byte_set(ref + 7, c, 40);
+    check("memset var", 40);
+    my_memcpy(buf + 100, buf + 200, 20);
+    byte_copy(ref + 100, ref + 200, 20);
+    check("my_memcpy", 20);
+
+    /* identical source and destination */
+    {
+        struct { char a[77]; } s, *p = &s;
+        fill((unsigned char *)s.a, 77, 4);
+        *p = s;
+        memcpy(ref, s.a, 77);
+        fill(buf, 77, 4);
+        if (memcmp(ref, buf, 77))
+            printf("self copy failed\n"), errors++;
+    }
+    printf("%d errors\n", errors);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/* loops run on vectors by -ftree-vectorize: stores, sums and searches
+   with every lane type, at all offsets and lengths so that the scalar
+   loop does the rest, and with stores into the arrays being read.  The
+   hash is the one of the loops compiled as scalar code. */
+
+#define N 1000
+
+int ga[N], gb[N], gc[N];
+float fx[N], fy[N];
+double dx[N], dy[N];
+signed char sc[N];
+unsigned char uc[N];
+short sh[N];
+long long ll[N];
+
+static unsigned hash;
+
+
+static void mix(const void *p, int n)
+{
+    const unsigned char *q = p;
+    while (n--)
+        hash = hash * 31 + *q++;
+}
+
+static int sum(int *a, int n)
+{
+    int s = 0;
+    for (int i = 0; i < n; i++)
+        s += a[i];
+    return s;
+}
+
+static long long lsum(long long *a, long n)
+{
+    long long s = 10;
+    for (long i = 0; i < n; ++i)
+        s -= a[i] * 3;
+    return s;
+}
+
+static void saxpy(float *y, float *x, float a, int n)
+{
+    for (int i = 0; i < n; i++)
+        y[i] = a * x[i] + y[i];
+}
+
+static void daxpy(double *y, double *x, double a, unsigned n)
+{
+    unsigned i;
+    for (i = 0; i < n; i += 1)
+        y[i] += a * x[i];
+}
+
+static int find(unsigned char *p, int n, int c)
+{
+    unsigned char ch = c;
+    int i;
+    for (i = 0; i < n; i++)
+        if (p[i] == ch || p[i] == 0)
+            break;
+    return i;
+}
+
+#ifdef __linux__
+/* a search must not read past the page that ends the string */
+static void page_end(void)
+{
+    unsigned char *p = mmap(0, 8192, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    int i;
+
+    mprotect(p + 4096, 4096, PROT_NONE);
+    for (i = 4000; i < 4096; i++)
+        p[i] = 'a' + i % 20;
+    p[4095] = 0;
+    for (i = 4000; i < 4096; i++)
+        if (find(p + i, 1 << 20, 'x') != 4095 - i)
+            printf("find %d\n", i);
+    munmap(p, 8192);
+}
+#endif
+
+static int findgt(int *a, int n, int k)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        if (a[i] > k)
+            break;
+    }
+    return i;
+}
+
+static void clamp(int *d, int *a, int lo, int hi, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = a[i] < lo ? lo : a[i] > hi ? hi : a[i];
+}
+
+static void fclamp(float *d, float *a, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = a[i] > 1.0f ? 1.0f : a[i];
+}
+
+static void mulw(short *d, short *a, short k, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = a[i] * k - (a[i] ^ 3);
+}
+
+static void mul32(int *d, int *a, int *b, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = a[i] * b[i] + 7;
+}
+
+static void bytes(signed char *d, signed char *a, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = a[i] > 10 && a[i] != 100 ? a[i] - 1 : -a[i];
+}
+
+static void shift(int *a, int n)
+{
+    /* overlapping: must behave like the scalar loop */
+    for (int i = 0; i < n; i++)
+        a[i] += a[i - 1] & 0xff | 1;
+}
+
+static int count(long long *a, int n, long long k)
+{
+    int c = 0, i;
+    for (i = 0; i < n; i++)
+        a[i] = a[i] >= k ? 1 : 0;
+    for (i = 0; i < n; i++)
+        c += a[i];
+    return c;
+}
+
+static unsigned usum(unsigned *a, unsigned long n)
+{
+    unsigned s = 0;
+    for (unsigned long i = 0; i < n; i++)
+        s += a[i] != 5u;
+    return s;
+}
+
+enum { K = 3 };
+
+static void globals(void)
+{
+    for (int i = 0; i < N; i++)
+        gc[i] = ga[i] * K + gb[i];
+}
+
+int main(void)
+{
+    int i, n, r;
+
+    for (i = 0; i < N; i++) {
+        ga[i] = i * 7 % 101 - 50;
+        gb[i] = i * 13 % 37;
+        fx[i] = (i % 17) * 0.25f - 1.5f;
+        fy[i] = i * 0.5f;
+        dx[i] = i * 0.125;
+        dy[i] = -i;
+        sc[i] = i * 5;
+        uc[i] = i % 200 + 1;
+        sh[i] = i * 3;
+        ll[i] = i * 100003LL;
+    }
+    uc[777] = 'x';
+    uc[900] = 0;
+    for (n = 0; n < 40; n++) {
+        r = sum(ga, n) + sum(ga + 1, N - n) + findgt(ga + n, N - n, 48 - n);
+        mix(&r, sizeof r);
+        mix(&(long long){lsum(ll + n, N - n)}, 8);
+        r = find(uc + n, N - n, 'x') + find(uc, n * 25, 201);
+        mix(&r, sizeof r);
+        r = usum((unsigned *)ga + n, N - n);
+        mix(&r, sizeof r);
+    }
+    for (n = 0; n < 20; n++) {
+        saxpy(fy + n, fx, 0.75f, N - n);
+        daxpy(dy, dx + n, -1.5, N - 2 * n);
+        clamp(gc + n, ga, -20, 30, N - n);
+        fclamp(fx + n, fy, N - n - 1);
+        mulw(sh, sh + n, n - 5, N - n);
+        mul32(gb + n, ga, gc, N - n);
+        bytes(sc + n, sc, N - n);
+        globals();
+        mix(fy, sizeof fy), mix(dy, sizeof dy), mix(gc, sizeof gc);
+        mix(fx, sizeof fx), mix(sh, sizeof sh), mix(gb, sizeof gb);
+        mix(sc, sizeof sc);
+    }
+    /* the stores reach elements loaded later */
+    saxpy(fy + 1, fy, 0.5f, N - 1);
+    saxpy(fy + 3, fy, 0.5f, N - 3);
+    saxpy(fy, fy + 2, 0.5f, N - 2);
+    bytes(sc + 15, sc, N - 15);
+    bytes(sc + 16, sc, N - 16);
+    mix(fy, sizeof fy), mix(sc, sizeof sc);
+    shift(ga + 1, N - 1);
+    mix(ga, sizeof ga);
+    r = count(ll, N, 50000000);
+    mix(&r, sizeof r);
+#ifdef __linux__
+    page_end();
+#endif
+    printf("%08x\n", hash);
+    return 0;
+}
@@ -0,0 +1,63 @@
+extern int printf(const char *, ...);
+
+/* referenced: kept */
+static int counter = 3;
+const int table[] = { 1, 2, 4, 8 };
+int zero[64];
+static const char *names[] = { "zero", "one", "two" };
+
+/* only referenced from the unreferenced functions: removed */
+int dead_data[1000] = { 1 };
+static const char dead_string[] = "dead";
+static int dead_bss[100];
+
+static int dead_static(int x)
+{
+    return x + dead_string[0] + dead_bss[x];
+}
+
+int dead_global(int x)
+{
+    return dead_static(x) + dead_data[x];
+}
+
+/* reached through a pointer in a data section */
+static int twice(int x)
+{
+    return 2 * x;
+}
+
+static int (*fp)(int) = twice;
+
+/* reached through .init_array */
+static void __attribute__((constructor)) setup(void)
+{
+    counter += 10;
+}
+
+/* sections with a C name are kept for __start_/__stop_ */
+static int __attribute__((section("gc_list"))) kept_list[] = { 5, 6, 7 };
+extern int __start_gc_list[], __stop_gc_list[];
+
+static int sum_list(void)
+{
+    int *p, s = 0;
+    for (p = __start_gc_list; p < __stop_gc_list; p++)
+        s += *p;
+    return s;
+}
+
+int count(void)
+{
+    static int calls;
+    return ++calls;
+}
+
+int main(void)
+{
+    zero[3] = table[2];
+    count();
+    printf("%d %d %d %s\n", counter, fp(table[3]), zero[3], names[2]);
+    printf("%d %d\n", sum_list(), count());
+    return 0;
+}
@@ -0,0 +1,67 @@
+extern int printf(const char *, ...);
+
+/* identical: folded */
+static int add_int(int a, int b)
+{
+    return a + b;
+}
+
+static int add_again(int a, int b)
+{
+    return a + b;
+}
+
+/* identical once their callees are folded */
+int square_sum(int x)
+{
+    return add_int(x, x) * x;
+}
+
+int square_sum_again(int x)
+{
+    return add_again(x, x) * x;
+}
+
+/* identical but for calling themselves */
+static int fact(int n)
+{
+    return n > 1 ? n * fact(n - 1) : 1;
+}
+
+static int fact_again(int n)
+{
+    return n > 1 ? n * fact_again(n - 1) : 1;
+}
+
+/* different constants: kept */
+static int scale2(int x)
+{
+    return x * 2;
+}
+
+static int scale3(int x)
+{
+    return x * 3;
+}
+
+/* identical but with their address taken: kept with --icf=safe */
+static int negate(int x)
+{
+    return -x;
+}
+
+static int negate_again(int x)
+{
+    return -x;
+}
+
+int main(void)
+{
+    int (*p)(int) = negate, (*q)(int) = negate_again;
+
+    printf("%d %d\n", square_sum(3), square_sum_again(4));
+    printf("%d %d\n", fact(5), fact_again(6));
+    printf("%d %d\n", scale2(7), scale3(7));
+    printf("%d %d %d\n", p(1), q(2), p == q);
+    return 0;
+}
@@ -0,0 +1,42 @@
+/* enough relocations for -j 4 to apply them from several threads */
+
+#include <stdio.h>
+
+#define T4 a, b, c, d,
+#define T64 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4 T4
+#define T1K T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64 T64
+#define C1 i = a(b(i) ^ 0x55) + (i >> 3);
+#define C16 C1 C1 C1 C1 C1 C1 C1 C1 C1 C1 C1 C1 C1 C1 C1 C1
+#define C256 C16 C16 C16 C16 C16 C16 C16 C16 C16 C16 C16 C16 C16 C16 C16 C16
+
+static int a(int i) { return i + 1; }
+static int b(int i) { return i * 3; }
+static int c(int i) { return i - 7; }
+static int d(int i) { return i ^ 0x1234; }
+
+int (*table[])(int) = {
+    T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K
+    T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K T1K
+};
+
+static const char *names[] = { "a", "b", "c", "d" };
+static const char **pnames[] = { names, names + 1, names + 2, names + 3 };
+
+static int calls(int i)
+{
+    C256 C256 C256 C256 C256 C256 C256 C256
+    C256 C256 C256 C256 C256 C256 C256 C256
+    return i;
+}
+
+int main(void)
+{
+    unsigned i, n = sizeof table / sizeof *table, acc = 0;
+
+    for (i = 0; i < n; ++i)
+        acc = acc * 7 + table[i](i);
+    printf("%u entries %08x\n", n, acc);
+    printf("calls %08x\n", (unsigned)calls(1));
+    printf("%s%s%s%s\n", *pnames[0], *pnames[1], *pnames[2], *pnames[3]);
+    return 0;
+}
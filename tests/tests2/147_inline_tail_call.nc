@@ -0,0 +1,30 @@
+/* a call statement in an inlined function which is itself
+   called in return position must not become a tail call */
+
+#include <stdio.h>
+
+int cnt;
+
+int g(int x)
+{
+    cnt += x;
+    return 100;
+}
+
+static int h(int x)
+{
+    g(x);
+    return x + 1;
+}
+
+int f(int x)
+{
+    return h(x);
+}
+
+int main(void)
+{
+    printf("%d\n", f(5));
+    printf("%d\n", cnt);
+    return 0;
+}
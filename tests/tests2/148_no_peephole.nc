@@ -0,0 +1,25 @@
+extern int printf(const char *, ...);
+
+/* mov $0x12345,%eax instead of movabs */
+long small(void)
+{
+    return 0x12345L;
+}
+
+/* mov $-2,%rax (sign extended) instead of movabs */
+long negative(void)
+{
+    return -2L;
+}
+
+/* test %eax,%eax instead of cmp $0,%eax */
+int is_zero(int x)
+{
+    return x == 0;
+}
+
+int main(void)
+{
+    printf("%lx %ld %d %d\n", small(), negative(), is_zero(0), is_zero(3));
+    return 0;
+}
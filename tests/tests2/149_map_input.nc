@@ -0,0 +1,37 @@
+/* linked from an object and from an archive bigger than 64KB, which
+   the linker maps instead of reading them */
+#include <stdio.h>
+
+#if defined BIG
+char big[0x180000] = { 1, 2, 3, [0x17ffff] = 4 };
+
+/* in a section of its own: the linker uses it from the mapping, and
+   the relocation of 'p' writes to it */
+struct big_sec {
+    char *p;
+    char pad[0x100000];
+} big_sec __attribute__((section(".big149"))) = { big + 2, { 5 } };
+
+int big_sum(void)
+{
+    return big[0] + big[1] + big[2];
+}
+#elif defined SMALL
+/* after the first MB of the archive */
+int small(void)
+{
+    return 42;
+}
+#else
+extern char big[];
+extern struct { char *p; char pad[1]; } big_sec;
+int big_sum(void);
+int small(void);
+
+int main(void)
+{
+    printf("%d %d %d %d %d\n", big_sum(), big[0x17ffff], small(),
+           *big_sec.p, big_sec.pad[0]);
+    return 0;
+}
+#endif
@@ -0,0 +1,44 @@
+/* a float compare with an empty branch: the jump to the next
+   instruction goes away, and so must the 'jp' over it */
+#include <stdio.h>
+#include <math.h>
+
+#define CMP(name, op) \
+long name(double a, double b) \
+{ \
+    long r = 1; \
+    if (a op b) {} \
+    r = 0x1122334455667788; \
+    return r; \
+} \
+long name##_f(float a, float b) \
+{ \
+    long r = 1; \
+    if (!(a op b)) {} \
+    r = 0x1122334455667788; \
+    return r; \
+}
+
+CMP(eq, ==)
+CMP(ne, !=)
+CMP(lt, <)
+CMP(le, <=)
+CMP(gt, >)
+CMP(ge, >=)
+
+typedef long (*cmp_d)(double, double);
+typedef long (*cmp_f)(float, float);
+
+int main(void)
+{
+    static const cmp_d fd[] = { eq, ne, lt, le, gt, ge };
+    static const cmp_f ff[] = { eq_f, ne_f, lt_f, le_f, gt_f, ge_f };
+    static const char *names[] = { "==", "!=", "<", "<=", ">", ">=" };
+    int i;
+
+    for (i = 0; i < 6; i++)
+        printf("%-2s %lx %lx %lx %lx\n", names[i],
+               fd[i](NAN, 1), fd[i](1, 1),
+               ff[i](NAN, 1), ff[i](1, NAN));
+    return 0;
+}
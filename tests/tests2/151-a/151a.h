@@ -0,0 +1 @@
+int a_151 = 1;
@@ -0,0 +1 @@
+int b_151 = 2;
@@ -0,0 +1,9 @@
+/* the include directories made by the Makefile are listed once per
+   process, and again only when they change */
+#include <151a.h>
+#include <151b.h>
+
+int main(void)
+{
+    return a_151 + b_151 - 3;
+}
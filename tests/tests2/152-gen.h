@@ -0,0 +1 @@
+#define V152 2
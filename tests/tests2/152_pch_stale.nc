@@ -0,0 +1,9 @@
+/* the Makefile makes 152.nch from a header, then rewrites the header
+   with the same size in the same second */
+#include <stdio.h>
+
+int main(void)
+{
+    printf("%d\n", V152);
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifdef BAD153
+#error stop here
+#endif
+
+int jobs_count = 2;
+
+int jobs_sum(int n)
+{
+    return n ? n + jobs_sum(n - 1) : 0;
+}
+
+const char *jobs_name(void)
+{
+    return "jobs";
+}
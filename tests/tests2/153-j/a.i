@@ -0,0 +1,755 @@
+# 1 "/root/repo/tests/tests2/153_jobs.nc"
+# 1 "<command line>" 1
+# 1 "/root/repo/tests/tests2/153_jobs.nc" 2
+
+
+
+# 1 "/usr/include/stdio.h" 1
+# 28 "/usr/include/stdio.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/libc-header-start.h" 1
+# 34 "/usr/include/x86_64-linux-gnu/bits/libc-header-start.h"
+# 1 "/usr/include/features.h" 1
+# 393 "/usr/include/features.h"
+# 1 "/usr/include/features-time64.h" 1
+# 21 "/usr/include/features-time64.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1
+# 20 "/usr/include/x86_64-linux-gnu/bits/timesize.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1
+# 21 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 2
+# 23 "/usr/include/features-time64.h" 2
+# 394 "/usr/include/features.h" 2
+# 468 "/usr/include/features.h"
+# 1 "/usr/include/stdc-predef.h" 1
+# 469 "/usr/include/features.h" 2
+# 490 "/usr/include/features.h"
+# 1 "/usr/include/x86_64-linux-gnu/sys/cdefs.h" 1
+# 562 "/usr/include/x86_64-linux-gnu/sys/cdefs.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1
+# 564 "/usr/include/x86_64-linux-gnu/sys/cdefs.h" 2
+# 491 "/usr/include/features.h" 2
+# 514 "/usr/include/features.h"
+# 1 "/usr/include/x86_64-linux-gnu/gnu/stubs.h" 1
+# 11 "/usr/include/x86_64-linux-gnu/gnu/stubs.h"
+# 1 "/usr/include/x86_64-linux-gnu/gnu/stubs-64.h" 1
+# 12 "/usr/include/x86_64-linux-gnu/gnu/stubs.h" 2
+# 515 "/usr/include/features.h" 2
+# 35 "/usr/include/x86_64-linux-gnu/bits/libc-header-start.h" 2
+# 29 "/usr/include/stdio.h" 2
+
+
+
+
+
+# 1 "/root/repo/include/stddef.h" 1
+
+
+
+typedef unsigned long size_t;
+typedef long ssize_t;
+typedef int wchar_t;
+typedef long ptrdiff_t;
+typedef long intptr_t;
+typedef unsigned long uintptr_t;
+# 23 "/root/repo/include/stddef.h"
+void *alloca(size_t size);
+# 35 "/usr/include/stdio.h" 2
+
+
+# 1 "/root/repo/include/stdarg.h" 1
+
+
+
+typedef __builtin_va_list va_list;
+
+
+
+
+
+
+typedef va_list __gnuc_va_list;
+# 38 "/usr/include/stdio.h" 2
+
+# 1 "/usr/include/x86_64-linux-gnu/bits/types.h" 1
+# 28 "/usr/include/x86_64-linux-gnu/bits/types.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1
+# 20 "/usr/include/x86_64-linux-gnu/bits/timesize.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/wordsize.h" 1
+# 21 "/usr/include/x86_64-linux-gnu/bits/timesize.h" 2
+# 30 "/usr/include/x86_64-linux-gnu/bits/types.h" 2
+
+typedef unsigned char __u_char;
+typedef unsigned short int __u_short;
+typedef unsigned int __u_int;
+typedef unsigned long int __u_long;
+
+
+typedef signed char __int8_t;
+typedef unsigned char __uint8_t;
+typedef signed short int __int16_t;
+typedef unsigned short int __uint16_t;
+typedef signed int __int32_t;
+typedef unsigned int __uint32_t;
+
+typedef signed long int __int64_t;
+typedef unsigned long int __uint64_t;
+
+
+
+
+
+
+typedef __int8_t __int_least8_t;
+typedef __uint8_t __uint_least8_t;
+typedef __int16_t __int_least16_t;
+typedef __uint16_t __uint_least16_t;
+typedef __int32_t __int_least32_t;
+typedef __uint32_t __uint_least32_t;
+typedef __int64_t __int_least64_t;
+typedef __uint64_t __uint_least64_t;
+
+
+
+typedef long int __quad_t;
+typedef unsigned long int __u_quad_t;
+
+
+
+
+
+
+
+typedef long int __intmax_t;
+typedef unsigned long int __uintmax_t;
+# 142 "/usr/include/x86_64-linux-gnu/bits/types.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/typesizes.h" 1
+# 144 "/usr/include/x86_64-linux-gnu/bits/types.h" 2
+
+typedef unsigned long int __dev_t;
+typedef unsigned int __uid_t;
+typedef unsigned int __gid_t;
+typedef unsigned long int __ino_t;
+typedef unsigned long int __ino64_t;
+typedef unsigned int __mode_t;
+typedef unsigned long int __nlink_t;
+typedef long int __off_t;
+typedef long int __off64_t;
+typedef int __pid_t;
+typedef struct { int __val[2]; } __fsid_t;
+typedef long int __clock_t;
+typedef unsigned long int __rlim_t;
+typedef unsigned long int __rlim64_t;
+typedef unsigned int __id_t;
+typedef long int __time_t;
+typedef unsigned int __useconds_t;
+typedef long int __suseconds_t;
+typedef long int __suseconds64_t;
+
+typedef int __daddr_t;
+typedef int __key_t;
+
+
+typedef int __clockid_t;
+
+
+typedef void * __timer_t;
+
+
+typedef long int __blksize_t;
+
+
+
+
+typedef long int __blkcnt_t;
+typedef long int __blkcnt64_t;
+
+
+typedef unsigned long int __fsblkcnt_t;
+typedef unsigned long int __fsblkcnt64_t;
+
+
+typedef unsigned long int __fsfilcnt_t;
+typedef unsigned long int __fsfilcnt64_t;
+
+
+typedef long int __fsword_t;
+
+typedef long int __ssize_t;
+
+
+typedef long int __syscall_slong_t;
+
+typedef unsigned long int __syscall_ulong_t;
+
+
+
+typedef __off64_t __loff_t;
+typedef char *__caddr_t;
+
+
+typedef long int __intptr_t;
+
+
+typedef unsigned int __socklen_t;
+
+
+
+
+typedef int __sig_atomic_t;
+# 6 "/usr/include/x86_64-linux-gnu/bits/types/__fpos_t.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/types/__mbstate_t.h" 1
+# 13 "/usr/include/x86_64-linux-gnu/bits/types/__mbstate_t.h"
+typedef struct
+{
+  int __count;
+  union
+  {
+    unsigned int __wch;
+    char __wchb[4];
+  } __value;
+} __mbstate_t;
+# 7 "/usr/include/x86_64-linux-gnu/bits/types/__fpos_t.h" 2
+
+
+
+typedef struct _G_fpos_t
+{
+  __off_t __pos;
+  __mbstate_t __state;
+} __fpos_t;
+# 10 "/usr/include/x86_64-linux-gnu/bits/types/__fpos64_t.h"
+typedef struct _G_fpos64_t
+{
+  __off64_t __pos;
+  __mbstate_t __state;
+} __fpos64_t;
+# 4 "/usr/include/x86_64-linux-gnu/bits/types/__FILE.h"
+struct _IO_FILE;
+typedef struct _IO_FILE __FILE;
+# 4 "/usr/include/x86_64-linux-gnu/bits/types/FILE.h"
+struct _IO_FILE;
+
+
+typedef struct _IO_FILE FILE;
+# 35 "/usr/include/x86_64-linux-gnu/bits/types/struct_FILE.h"
+struct _IO_FILE;
+struct _IO_marker;
+struct _IO_codecvt;
+struct _IO_wide_data;
+
+
+
+
+typedef void _IO_lock_t;
+
+
+
+
+
+struct _IO_FILE
+{
+  int _flags;
+
+
+  char *_IO_read_ptr;
+  char *_IO_read_end;
+  char *_IO_read_base;
+  char *_IO_write_base;
+  char *_IO_write_ptr;
+  char *_IO_write_end;
+  char *_IO_buf_base;
+  char *_IO_buf_end;
+
+
+  char *_IO_save_base;
+  char *_IO_backup_base;
+  char *_IO_save_end;
+
+  struct _IO_marker *_markers;
+
+  struct _IO_FILE *_chain;
+
+  int _fileno;
+  int _flags2;
+  __off_t _old_offset;
+
+
+  unsigned short _cur_column;
+  signed char _vtable_offset;
+  char _shortbuf[1];
+
+  _IO_lock_t *_lock;
+
+
+
+
+
+
+
+  __off64_t _offset;
+
+  struct _IO_codecvt *_codecvt;
+  struct _IO_wide_data *_wide_data;
+  struct _IO_FILE *_freeres_list;
+  void *_freeres_buf;
+  size_t __pad5;
+  int _mode;
+
+  char _unused2[15 * sizeof (int) - 4 * sizeof (void *) - sizeof (size_t)];
+};
+# 45 "/usr/include/stdio.h" 2
+# 63 "/usr/include/stdio.h"
+typedef __off_t off_t;
+# 77 "/usr/include/stdio.h"
+typedef __ssize_t ssize_t;
+
+
+
+
+
+
+typedef __fpos_t fpos_t;
+# 134 "/usr/include/stdio.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/stdio_lim.h" 1
+# 135 "/usr/include/stdio.h" 2
+# 143 "/usr/include/stdio.h"
+extern FILE *stdin;
+extern FILE *stdout;
+extern FILE *stderr;
+
+
+
+
+
+
+extern int remove (const char *__filename) ;
+
+extern int rename (const char *__old, const char *__new) ;
+
+
+
+extern int renameat (int __oldfd, const char *__old, int __newfd,
+		     const char *__new) ;
+# 178 "/usr/include/stdio.h"
+extern int fclose (FILE *__stream);
+# 188 "/usr/include/stdio.h"
+extern FILE *tmpfile (void)
+    ;
+# 205 "/usr/include/stdio.h"
+extern char *tmpnam (char[20])  ;
+
+
+
+
+extern char *tmpnam_r (char __s[20])  ;
+# 222 "/usr/include/stdio.h"
+extern char *tempnam (const char *__dir, const char *__pfx)
+      ;
+
+
+
+
+
+
+extern int fflush (FILE *__stream);
+# 239 "/usr/include/stdio.h"
+extern int fflush_unlocked (FILE *__stream);
+# 258 "/usr/include/stdio.h"
+extern FILE *fopen (const char *restrict __filename,
+		    const char *restrict __modes)
+    ;
+
+
+
+
+extern FILE *freopen (const char *restrict __filename,
+		      const char *restrict __modes,
+		      FILE *restrict __stream) ;
+# 293 "/usr/include/stdio.h"
+extern FILE *fdopen (int __fd, const char *__modes)
+    ;
+# 308 "/usr/include/stdio.h"
+extern FILE *fmemopen (void *__s, size_t __len, const char *__modes)
+     ;
+
+
+
+
+extern FILE *open_memstream (char **__bufloc, size_t *__sizeloc)
+    ;
+# 328 "/usr/include/stdio.h"
+extern void setbuf (FILE *restrict __stream, char *restrict __buf) ;
+
+
+
+extern int setvbuf (FILE *restrict __stream, char *restrict __buf,
+		    int __modes, size_t __n) ;
+
+
+
+
+extern void setbuffer (FILE *restrict __stream, char *restrict __buf,
+		       size_t __size) ;
+
+
+extern void setlinebuf (FILE *__stream) ;
+
+
+
+
+
+
+
+extern int fprintf (FILE *restrict __stream,
+		    const char *restrict __format, ...);
+
+
+
+
+extern int printf (const char *restrict __format, ...);
+
+extern int sprintf (char *restrict __s,
+		    const char *restrict __format, ...) ;
+
+
+
+
+
+extern int vfprintf (FILE *restrict __s, const char *restrict __format,
+		     __gnuc_va_list __arg);
+
+
+
+
+extern int vprintf (const char *restrict __format, __gnuc_va_list __arg);
+
+extern int vsprintf (char *restrict __s, const char *restrict __format,
+		     __gnuc_va_list __arg) ;
+
+
+
+extern int snprintf (char *restrict __s, size_t __maxlen,
+		     const char *restrict __format, ...)
+      ;
+
+extern int vsnprintf (char *restrict __s, size_t __maxlen,
+		      const char *restrict __format, __gnuc_va_list __arg)
+      ;
+# 403 "/usr/include/stdio.h"
+extern int vdprintf (int __fd, const char *restrict __fmt,
+		     __gnuc_va_list __arg)
+     ;
+extern int dprintf (int __fd, const char *restrict __fmt, ...)
+     ;
+
+
+
+
+
+
+
+extern int fscanf (FILE *restrict __stream,
+		   const char *restrict __format, ...) ;
+
+
+
+
+extern int scanf (const char *restrict __format, ...) ;
+
+extern int sscanf (const char *restrict __s,
+		   const char *restrict __format, ...) ;
+
+
+
+
+
+
+# 1 "/usr/include/x86_64-linux-gnu/bits/floatn.h" 1
+# 121 "/usr/include/x86_64-linux-gnu/bits/floatn.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/floatn-common.h" 1
+# 25 "/usr/include/x86_64-linux-gnu/bits/floatn-common.h"
+# 1 "/usr/include/x86_64-linux-gnu/bits/long-double.h" 1
+# 26 "/usr/include/x86_64-linux-gnu/bits/floatn-common.h" 2
+# 214 "/usr/include/x86_64-linux-gnu/bits/floatn-common.h"
+typedef float _Float32;
+# 251 "/usr/include/x86_64-linux-gnu/bits/floatn-common.h"
+typedef double _Float64;
+# 268 "/usr/include/x86_64-linux-gnu/bits/floatn-common.h"
+typedef double _Float32x;
+# 285 "/usr/include/x86_64-linux-gnu/bits/floatn-common.h"
+typedef long double _Float64x;
+# 122 "/usr/include/x86_64-linux-gnu/bits/floatn.h" 2
+# 433 "/usr/include/stdio.h" 2
+
+extern int fscanf (FILE *restrict __stream, const char *restrict __format, ...) __asm__("__isoc99_fscanf") ;
+
+
+extern int scanf (const char *restrict __format, ...) __asm__("__isoc99_scanf") ;
+
+extern int sscanf (const char *restrict __s, const char *restrict __format, ...) __asm__("__isoc99_sscanf");
+# 459 "/usr/include/stdio.h"
+extern int vfscanf (FILE *restrict __s, const char *restrict __format,
+		    __gnuc_va_list __arg)
+      ;
+
+
+
+
+
+extern int vscanf (const char *restrict __format, __gnuc_va_list __arg)
+      ;
+
+
+extern int vsscanf (const char *restrict __s,
+		    const char *restrict __format, __gnuc_va_list __arg)
+      ;
+
+
+
+
+
+extern int vfscanf (FILE *restrict __s, const char *restrict __format, __gnuc_va_list __arg) __asm__("__isoc99_vfscanf")
+
+
+
+      ;
+extern int vscanf (const char *restrict __format, __gnuc_va_list __arg) __asm__("__isoc99_vscanf")
+
+      ;
+extern int vsscanf (const char *restrict __s, const char *restrict __format, __gnuc_va_list __arg) __asm__("__isoc99_vsscanf")
+
+
+
+     ;
+# 513 "/usr/include/stdio.h"
+extern int fgetc (FILE *__stream);
+extern int getc (FILE *__stream);
+
+
+
+
+
+extern int getchar (void);
+
+
+
+
+
+
+extern int getc_unlocked (FILE *__stream);
+extern int getchar_unlocked (void);
+# 538 "/usr/include/stdio.h"
+extern int fgetc_unlocked (FILE *__stream);
+# 549 "/usr/include/stdio.h"
+extern int fputc (int __c, FILE *__stream);
+extern int putc (int __c, FILE *__stream);
+
+
+
+
+
+extern int putchar (int __c);
+# 565 "/usr/include/stdio.h"
+extern int fputc_unlocked (int __c, FILE *__stream);
+
+
+
+
+
+
+
+extern int putc_unlocked (int __c, FILE *__stream);
+extern int putchar_unlocked (int __c);
+
+
+
+
+
+
+extern int getw (FILE *__stream);
+
+
+extern int putw (int __w, FILE *__stream);
+
+
+
+
+
+
+
+extern char *fgets (char *restrict __s, int __n, FILE *restrict __stream)
+      ;
+# 605 "/usr/include/stdio.h"
+extern char *gets (char *__s)  ;
+# 632 "/usr/include/stdio.h"
+extern __ssize_t __getdelim (char **restrict __lineptr,
+                             size_t *restrict __n, int __delimiter,
+                             FILE *restrict __stream) ;
+extern __ssize_t getdelim (char **restrict __lineptr,
+                           size_t *restrict __n, int __delimiter,
+                           FILE *restrict __stream) ;
+
+
+
+
+
+
+
+extern __ssize_t getline (char **restrict __lineptr,
+                          size_t *restrict __n,
+                          FILE *restrict __stream) ;
+
+
+
+
+
+
+
+extern int fputs (const char *restrict __s, FILE *restrict __stream);
+
+
+
+
+
+extern int puts (const char *__s);
+
+
+
+
+
+
+extern int ungetc (int __c, FILE *__stream);
+
+
+
+
+
+
+extern size_t fread (void *restrict __ptr, size_t __size,
+		     size_t __n, FILE *restrict __stream) ;
+
+
+
+
+extern size_t fwrite (const void *restrict __ptr, size_t __size,
+		      size_t __n, FILE *restrict __s);
+# 702 "/usr/include/stdio.h"
+extern size_t fread_unlocked (void *restrict __ptr, size_t __size,
+			      size_t __n, FILE *restrict __stream) ;
+extern size_t fwrite_unlocked (const void *restrict __ptr, size_t __size,
+			       size_t __n, FILE *restrict __stream);
+
+
+
+
+
+
+
+extern int fseek (FILE *__stream, long int __off, int __whence);
+
+
+
+
+extern long int ftell (FILE *__stream) ;
+
+
+
+
+extern void rewind (FILE *__stream);
+# 736 "/usr/include/stdio.h"
+extern int fseeko (FILE *__stream, __off_t __off, int __whence);
+
+
+
+
+extern __off_t ftello (FILE *__stream) ;
+# 760 "/usr/include/stdio.h"
+extern int fgetpos (FILE *restrict __stream, fpos_t *restrict __pos);
+
+
+
+
+extern int fsetpos (FILE *__stream, const fpos_t *__pos);
+# 786 "/usr/include/stdio.h"
+extern void clearerr (FILE *__stream) ;
+
+extern int feof (FILE *__stream)  ;
+
+extern int ferror (FILE *__stream)  ;
+
+
+
+extern void clearerr_unlocked (FILE *__stream) ;
+extern int feof_unlocked (FILE *__stream)  ;
+extern int ferror_unlocked (FILE *__stream)  ;
+
+
+
+
+
+
+
+extern void perror (const char *__s);
+
+
+
+
+extern int fileno (FILE *__stream)  ;
+
+
+
+
+extern int fileno_unlocked (FILE *__stream)  ;
+# 823 "/usr/include/stdio.h"
+extern int pclose (FILE *__stream);
+
+
+
+
+
+extern FILE *popen (const char *__command, const char *__modes)
+    ;
+
+
+
+
+
+
+extern char *ctermid (char *__s)
+  ;
+# 867 "/usr/include/stdio.h"
+extern void flockfile (FILE *__stream) ;
+
+
+
+extern int ftrylockfile (FILE *__stream)  ;
+
+
+extern void funlockfile (FILE *__stream) ;
+# 885 "/usr/include/stdio.h"
+extern int __uflow (FILE *);
+extern int __overflow (FILE *, int);
+# 5 "/root/repo/tests/tests2/153_jobs.nc" 2
+extern int jobs_count;
+int jobs_sum(int n);
+const char *jobs_name(void);
+
+int main(void)
+{
+    printf("%s %d %d\n", jobs_name(), jobs_sum(10), jobs_count);
+    return 0;
+}
+# 1 "/root/repo/tests/tests2/153+_jobs.nc"
+# 1 "<command line>" 1
+# 4 "/root/repo/tests/tests2/153+_jobs.nc" 2
+
+int jobs_count = 2;
+
+int jobs_sum(int n)
+{
+    return n ? n + jobs_sum(n - 1) : 0;
+}
+
+const char *jobs_name(void)
+{
+    return "jobs";
+}
@@ -0,0 +1,13 @@
+/* built from two sources with and without -j, see the Makefile */
+
+#include <stdio.h>
+
+extern int jobs_count;
+int jobs_sum(int n);
+const char *jobs_name(void);
+
+int main(void)
+{
+    printf("%s %d %d\n", jobs_name(), jobs_sum(10), jobs_count);
+    return 0;
+}
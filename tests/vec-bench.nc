@@ -0,0 +1,61 @@
+/* loops for -ftree-vectorize: a sum, saxpy, a clamp and a byte search
+   over arrays that fit in the cache, see 'make vecbench' */
+
+#include <stdio.h>
+
+#define N 4096
+
+static int a[N], b[N];
+static float x[N], y[N];
+static unsigned char text[N];
+
+static int sum(int *p, int n)
+{
+    int s = 0;
+    for (int i = 0; i < n; i++)
+        s += p[i];
+    return s;
+}
+
+static void saxpy(float *d, float *s, float k, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = k * s[i] + d[i];
+}
+
+static void clamp(int *d, int *s, int lo, int hi, int n)
+{
+    for (int i = 0; i < n; i++)
+        d[i] = s[i] < lo ? lo : s[i] > hi ? hi : s[i];
+}
+
+static int find(unsigned char *p, int n, int c)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        if (p[i] == c)
+            break;
+    return i;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned acc = 0, seed = 12345;
+    int i;
+
+    for (i = 0; i < N; i++) {
+        seed = seed * 1103515245 + 12345;
+        a[i] = (int)(seed >> 16) % 1000 - 500;
+        x[i] = (seed >> 20) * 0.001f;
+        text[i] = 'a' + (seed >> 24) % 26;
+    }
+    text[N - 1] = '!';
+    for (i = 0; i < 20000; i++) {
+        acc += sum(a, N);
+        saxpy(y, x, 0.5f, N);
+        clamp(b, a, -100, 100, N);
+        acc += b[i % N] + find(text, N, '!');
+    }
+    printf("%u %g\n", acc, y[N / 2]);
+    return 0;
+}
@@ -111,6 +111,50 @@ enum {
 #define NOOC_TARGET_NATIVE_STRUCT_COPY
 ST_FUNC void gen_struct_copy(int size);
 
+/* memcpy and memset of small constant sizes are expanded into moves */
+#define NOOC_TARGET_INLINE_MEM
+ST_FUNC int inline_mem_max(int c);
+ST_FUNC void gen_inline_mem(int c, int size);
+
+#define NOOC_TARGET_JUMP_TABLE
+ST_FUNC void gen_jmp_table(int *tab, int n);
+
+/* gen_opi() does TOK_UMULH and TOK_SMULH */
+#define NOOC_TARGET_MULH
+
+#ifndef NOOC_TARGET_PE
+/* -O1: up to 5 scalar locals in callee saved registers */
+#define NOOC_TARGET_REGVARS 5
+ST_FUNC int gen_regvar(int addr, int param);
+
+/* -foptimize-sibling-calls */
+#define NOOC_TARGET_TAIL_CALL
+ST_FUNC int gfunc_tail_call(int nb_args);
+
+/* -ftree-vectorize: operations on the vector registers 0..15 */
+#define NOOC_TARGET_VECTORIZE
+/* for the index, the bound and the arrays, leaving RC_INT for gv() */
+#define VEC_RC { RC_R8, RC_R9, RC_R10, RC_R11, RC_RSI, RC_RDI }
+enum {
+    VEC_ADD, VEC_SUB, VEC_MUL, VEC_AND, VEC_OR, VEC_XOR,
+    VEC_ANDN, /* d = ~d & s */
+    VEC_MOV,
+    VEC_CMPEQ, VEC_CMPNE, VEC_CMPLT, VEC_CMPLE, VEC_CMPGT,
+    VEC_NB_OPS
+};
+ST_FUNC int gen_vec_size(void);
+ST_FUNC int gen_vec_ok(int op, int t);
+ST_FUNC void gen_vec_op(int op, int t, int d, int s);
+ST_FUNC void gen_vec_mem(int store, int x, int base, int index, int size);
+ST_FUNC void gen_vec_splat(int x, int t);
+ST_FUNC void gen_vec_reduce(int x, int tmp, int t);
+ST_FUNC int gen_vec_any(int x, int t);
+ST_FUNC int gen_vec_overlap(int d, int s, int t);
+ST_FUNC int gen_vec_page(int base, int index, int size, int t);
+ST_FUNC int gen_vec_jmp(int ri, int rn, int step, int n, int op, int t);
+ST_FUNC void gen_vec_end(void);
+#endif
+
 /******************************************************/
 #else /* ! TARGET_DEFS_ONLY */
 /******************************************************/
@@ -154,17 +198,53 @@ ST_DATA const int reg_classes[NB_REGS] = {
     /* st0 */ RC_ST0
 };
 
-static unsigned long func_sub_sp_offset;
-static int func_ret_sub;
+static ST_TLS unsigned long func_sub_sp_offset;
+static ST_TLS int func_ret_sub;
+static ST_TLS int func_frame_used; /* a local or parameter was addressed */
+static ST_TLS int func_addr_taken; /* the address of a local may be used */
+
+#ifndef NOOC_TARGET_PE
+/* calls in return position, which jump to the end of the function,
+   see gfunc_epilog() */
+#define TAIL_CALLS_MAX 64
+static ST_TLS struct tail_call {
+    int jmp;
+    Sym *sym; /* the function, or NULL for *%r11 */
+    int c;
+} tail_calls[TAIL_CALLS_MAX];
+static ST_TLS int nb_tail_calls, func_tail;
+#endif
+
+#ifdef NOOC_TARGET_REGVARS
+/* locals kept in %rbx, %r12-%r15, by frame offset, see gen_regvar() */
+static const uint8_t regvar_regs[NOOC_TARGET_REGVARS] = { 3, 12, 13, 14, 15 };
+static ST_TLS int regvar_addr[NOOC_TARGET_REGVARS];
+static ST_TLS int nb_regvars;
+
+static int regvar_find(int addr)
+{
+    int i;
+    for (i = 0; i < nb_regvars; i++)
+        if (regvar_addr[i] == addr)
+            return regvar_regs[i];
+    return -1;
+}
+#endif
+
+/* peephole: the last jump emitted by gjmp() or gjmp_cond() and the
+   last store of a register to the frame, by the address just after
+   them, while nothing else has been emitted since */
+static ST_TLS int peep_jmp, peep_jmp_end;
+static ST_TLS int peep_st_end, peep_st_r, peep_st_c, peep_st_ll;
 
 #if defined(CONFIG_NOOC_BCHECK)
-static addr_t func_bound_offset;
-static unsigned long func_bound_ind;
+static ST_TLS addr_t func_bound_offset;
+static ST_TLS unsigned long func_bound_ind;
 ST_DATA int func_bound_add_epilog;
 #endif
 
 #ifdef NOOC_TARGET_PE
-static int func_scratch, func_alloca;
+static ST_TLS int func_scratch, func_alloca;
 #endif
 
 /* XXX: make it faster ? */
@@ -228,6 +308,20 @@ static void orex(int ll, int r, int r2, int b)
 /* output a symbol and patch all calls to it */
 ST_FUNC void gsym_addr(int t, int a)
 {
+    int n;
+
+    if (a == ind && peep_jmp_end == ind && label_ind != ind && !debug_modes
+        && !nooc_state->no_peephole) {
+        /* drop the last jump if it is to here */
+        for (n = t; n; n = read32le(cur_text_section->data + n))
+            if (n == ind - 4) {
+                a = ind = peep_jmp;
+                peep_jmp_end = 0;
+                break;
+            }
+    }
+    if (a >= 0)
+        label_ind = a;
     while (t) {
         unsigned char *ptr = cur_text_section->data + t;
         uint32_t n = read32le(ptr); /* next value */
@@ -321,6 +415,7 @@ static void gen_modrm_impl(int op_reg, int r, Sym *sym, int c, int is_got)
 	}
     } else if ((r & VT_VALMASK) == VT_LOCAL) {
         /* currently, we use only ebp as base */
+        func_frame_used = 1;
         if (c == (char)c) {
             /* short reference */
             o(0x45 | op_reg);
@@ -361,7 +456,7 @@ static void gen_modrm64(int opcode, int op_reg, int r, Sym *sym, int c)
 /* load 'r' from value 'sv' */
 void load(int r, SValue *sv)
 {
-    int v, t, ft, fc, fr;
+    int v, t, b, ft, fc, fr;
     SValue v1;
 
 #ifdef NOOC_TARGET_PE
@@ -395,8 +490,36 @@ void load(int r, SValue *sv)
 #endif
 
     v = fr & VT_VALMASK;
+#ifdef NOOC_TARGET_REGVARS
+    if (v == VT_LOCAL && nb_regvars && (t = regvar_find(fc)) >= 0) {
+        if (!(fr & VT_LVAL))
+            nooc_error("internal error: address of register variable");
+        switch (ft & VT_TYPE) {
+        case VT_BYTE: case VT_BOOL: b = 0xbe0f; break; /* movsbl */
+        case VT_BYTE | VT_UNSIGNED: b = 0xb60f; break; /* movzbl */
+        case VT_SHORT: b = 0xbf0f; break; /* movswl */
+        case VT_SHORT | VT_UNSIGNED: b = 0xb70f; break; /* movzwl */
+        default: b = 0x8b; break; /* mov */
+        }
+        orex(b == 0x8b && is64_type(ft), t, r, b);
+        o(0xc0 + REG_VALUE(t) + REG_VALUE(r) * 8);
+        return;
+    }
+#endif
     if (fr & VT_LVAL) {
-        int b, ll;
+        int ll;
+        if (v == VT_LOCAL && peep_st_end == ind && label_ind != ind
+            && fc == peep_st_c && !(sv->type.t & VT_VOLATILE)
+            && ((ft & VT_BTYPE) == VT_INT ? !peep_st_ll
+                : is64_type(ft) && peep_st_ll)
+            && !nooc_state->no_peephole) {
+            /* the value was just stored from a register */
+            if (r != peep_st_r) {
+                orex(peep_st_ll, r, peep_st_r, 0x89);
+                o(0xc0 + REG_VALUE(r) + REG_VALUE(peep_st_r) * 8); /* mov */
+            }
+            return;
+        }
         if (v == VT_LLOCAL) {
             v1.type.t = VT_PTR;
             v1.r = VT_LOCAL | VT_LVAL;
@@ -488,14 +611,22 @@ void load(int r, SValue *sv)
                     gen_gotpcrel(r, sv->sym, fc);
                 }
 #endif
-            } else if (is64_type(ft)) {
-                orex(1,r,0, 0xb8 + REG_VALUE(r)); /* mov $xx, r */
-                gen_le64(sv->c.i);
+            } else if (is64_type(ft) && (sv->c.i != (uint32_t)sv->c.i
+                                         || nooc_state->no_peephole)) {
+                if (sv->c.i == (int)sv->c.i && !nooc_state->no_peephole) {
+                    orex(1,r,0, 0xc7); /* mov $xx, r (sign extended) */
+                    o(0xc0 + REG_VALUE(r));
+                    gen_le32(fc);
+                } else {
+                    orex(1,r,0, 0xb8 + REG_VALUE(r)); /* mov $xx, r */
+                    gen_le64(sv->c.i);
+                }
             } else {
                 orex(0,r,0, 0xb8 + REG_VALUE(r)); /* mov $xx, r */
                 gen_le32(fc);
             }
         } else if (v == VT_LOCAL) {
+            func_addr_taken = 1;
             orex(1,0,r,0x8d); /* lea xxx(%ebp), r */
             gen_modrm(r, VT_LOCAL, sv->sym, fc);
         } else if (v == VT_CMP) {
@@ -527,6 +658,7 @@ void load(int r, SValue *sv)
             if ((r >= TREG_XMM0) && (r <= TREG_XMM7)) {
                 if (v == TREG_ST0) {
                     /* gen_cvt_ftof(VT_DOUBLE); */
+                    func_leaf = 0; /* no red zone */
                     o(0xf0245cdd); /* fstpl -0x10(%rsp) */
                     /* movsd -0x10(%rsp),%xmmN */
                     o(0x100ff2);
@@ -545,6 +677,7 @@ void load(int r, SValue *sv)
             } else if (r == TREG_ST0) {
                 assert((v >= TREG_XMM0) && (v <= TREG_XMM7));
                 /* gen_cvt_ftof(VT_LDOUBLE); */
+                func_leaf = 0;
                 /* movsd %xmmN,-0x10(%rsp) */
                 o(0x110ff2);
                 o(0x44 + REG_VALUE(r)*8); /* %xmmN */
@@ -579,6 +712,18 @@ void store(int r, SValue *v)
     ft &= ~(VT_VOLATILE | VT_CONSTANT);
     bt = ft & VT_BTYPE;
 
+#ifdef NOOC_TARGET_REGVARS
+    if (fr == VT_LOCAL && nb_regvars) {
+        int t = regvar_find(fc);
+        if (t >= 0) {
+            /* copy the whole register, load() extends as needed */
+            orex(1, t, r, 0x89);
+            o(0xc0 + REG_VALUE(t) + REG_VALUE(r) * 8); /* mov r, reg */
+            return;
+        }
+    }
+#endif
+
 #ifndef NOOC_TARGET_PE
     /* we need to access the variable via got */
     if (fr == VT_CONST
@@ -637,12 +782,21 @@ void store(int r, SValue *v)
             o(0xc0 + fr + r * 8); /* mov r, fr */
         }
     }
+    if (v->r == (VT_LOCAL | VT_LVAL) && (bt == VT_INT || is64_type(bt))
+        && !(v->type.t & VT_VOLATILE)) {
+        /* remember for load() */
+        peep_st_end = ind;
+        peep_st_r = r;
+        peep_st_c = fc;
+        peep_st_ll = is64_type(bt);
+    }
 }
 
 /* 'is_jmp' is '1' if it is a jump */
 static void gcall_or_jmp(int is_jmp)
 {
     int r;
+    func_leaf = 0;
     if ((vtop->r & (VT_VALMASK | VT_LVAL)) == VT_CONST &&
 	((vtop->r & VT_SYM) && (vtop->c.i-4) == (int)(vtop->c.i-4))) {
         /* constant symbolic case -> simple relocation */
@@ -957,6 +1111,7 @@ void gfunc_prolog(Sym *func_sym)
 
     addr = PTR_SIZE * 2;
     ind += FUNC_PROLOG_SIZE;
+    peep_jmp_end = peep_st_end = 0;
     func_sub_sp_offset = ind;
     reg_param_index = 0;
 
@@ -1289,6 +1444,8 @@ void gfunc_call(int nb_args)
 
     if (nb_sse_args && nooc_state->nosse)
       nooc_error("SSE disabled but floating point arguments passed");
+    if (stack_adjust)
+        func_tail = 0;
 
     /* fetch cpu flag before generating any code */
     if ((vtop->r & VT_VALMASK) == VT_CMP)
@@ -1448,13 +1605,61 @@ void gfunc_call(int nb_args)
 
     if (vtop->type.ref->f.func_type != FUNC_NEW) /* implies FUNC_OLD or FUNC_ELLIPSIS */
         oad(0xb8, nb_sse_args < 8 ? nb_sse_args : 8); /* mov nb_sse_args, %eax */
-    gcall_or_jmp(0);
+    if (func_tail) {
+        struct tail_call *tc = &tail_calls[nb_tail_calls++];
+        tc->sym = NULL;
+        if ((vtop->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == (VT_CONST | VT_SYM)
+            && (vtop->c.i-4) == (int)(vtop->c.i-4)) {
+            tc->sym = vtop->sym;
+            tc->c = vtop->c.i;
+        } else {
+            load(TREG_R11, vtop);
+        }
+        tc->jmp = gjmp2(0xe9, 0);
+    } else {
+        gcall_or_jmp(0);
+    }
     if (args_size)
         gadd_sp(args_size);
     vtop--;
 }
 
+/* like gfunc_call() for a call in return position, but jump to the
+   function when the arguments are all passed in registers.  Returns 0
+   if it was called as usual. */
+ST_FUNC int gfunc_tail_call(int nb_args)
+{
+    int done;
+
+    func_tail = nb_tail_calls < TAIL_CALLS_MAX && !nooc_state->do_bounds_check;
+    gfunc_call(nb_args);
+    done = func_tail;
+    func_tail = 0;
+    return done;
+}
+
 #define FUNC_PROLOG_SIZE 11
+#define REGVAR_PROLOG_SIZE 9 /* push %rbx, push %r12 .. %r15 */
+#define RED_ZONE_SIZE 128
+
+static ST_TLS int func_regvar_size;
+static ST_TLS Sym *func_prolog_sym;
+
+/* keep the local at 'addr' in a callee saved register, loading it
+   from there if it is a parameter.  The registers are pushed by the
+   prolog, below %rbp where gfunc_prolog() left room for them. */
+ST_FUNC int gen_regvar(int addr, int param)
+{
+    int r;
+
+    if (nb_regvars >= func_regvars)
+        return 0;
+    r = regvar_regs[nb_regvars];
+    if (param)
+        gen_modrm64(0x8b, r, VT_LOCAL, NULL, addr); /* mov addr(%rbp), r */
+    regvar_addr[nb_regvars++] = addr;
+    return 1;
+}
 
 static void push_arg_reg(int i) {
     loc -= 8;
@@ -1475,6 +1680,17 @@ void gfunc_prolog(Sym *func_sym)
     addr = PTR_SIZE * 2;
     loc = 0;
     ind += FUNC_PROLOG_SIZE;
+    peep_jmp_end = peep_st_end = 0;
+    func_frame_used = func_addr_taken = 0;
+    nb_tail_calls = 0;
+    func_prolog_sym = func_sym;
+    nb_regvars = 0;
+    func_regvar_size = 0;
+    if (func_regvars) {
+        func_regvar_size = REGVAR_PROLOG_SIZE;
+        ind += REGVAR_PROLOG_SIZE;
+        loc = -8 * func_regvars;
+    }
     func_sub_sp_offset = ind;
     func_ret_sub = 0;
     ret_mode = classify_x86_64_arg(&func_vt, NULL, &size, &align, &reg_count);
@@ -1615,16 +1831,33 @@ void gfunc_prolog(Sym *func_sym)
 #endif
 }
 
-/* generate function epilog */
+/* generate function epilog.  A leaf function, which does not move
+   %rsp after the prolog, keeps up to RED_ZONE_SIZE bytes of locals below
+   %rsp without allocating them, and needs no frame at all if it never
+   addresses one.  The frame is kept with -g and -bt, for debuggers and
+   rt_get_caller_pc() which follow the %rbp chain.
+
+   The calls in return position jump here, and are then made after the
+   frame is left, unless the callee may see the address of a local. */
 void gfunc_epilog(void)
 {
-    int v, saved_ind;
+    int v, i, saved_ind, start, frame, leaf, tail, epilog;
+    struct tail_call *tc;
+    ElfSym *esym;
 
 #ifdef CONFIG_NOOC_BCHECK
     if (nooc_state->do_bounds_check)
         gen_bounds_epilog();
 #endif
-    o(0xc9); /* leave */
+    tail = !func_addr_taken;
+    leaf = func_leaf && !nooc_state->do_bounds_check
+        && (tail || !nb_tail_calls);
+    frame = !leaf || func_frame_used || nb_regvars || nooc_state->do_debug;
+    epilog = ind;
+    for (i = 0; i < nb_regvars; i++) /* mov -8(i+1)(%rbp), reg */
+        gen_modrm64(0x8b, regvar_regs[i], VT_LOCAL, NULL, -8 * (i + 1));
+    if (frame)
+        o(0xc9); /* leave */
     if (func_ret_sub == 0) {
         o(0xc3); /* ret */
     } else {
@@ -1632,13 +1865,55 @@ void gfunc_epilog(void)
         g(func_ret_sub);
         g(func_ret_sub >> 8);
     }
+    for (tc = tail_calls; tc < tail_calls + nb_tail_calls; tc++) {
+        gsym_addr(tc->jmp, ind);
+        if (tail) {
+            for (i = 0; i < nb_regvars; i++)
+                gen_modrm64(0x8b, regvar_regs[i], VT_LOCAL, NULL, -8 * (i + 1));
+            if (frame)
+                o(0xc9); /* leave */
+        }
+        if (tc->sym) {
+            greloca(cur_text_section, tc->sym, ind + 1, R_X86_64_PLT32, tc->c - 4);
+            oad(0xe8 + tail, 0); /* call/jmp im */
+        } else {
+            o(0xd3ff41 + (tail << 20)); /* call/jmp *%r11 */
+        }
+        if (!tail)
+            gjmp_addr(epilog);
+    }
     /* align local size to word & save local variables */
     v = (-loc + 15) & -16;
     saved_ind = ind;
-    ind = func_sub_sp_offset - FUNC_PROLOG_SIZE;
-    o(0xe5894855);  /* push %rbp, mov %rsp, %rbp */
-    o(0xec8148);  /* sub rsp, stacksize */
-    gen_le32(v);
+    start = func_sub_sp_offset - FUNC_PROLOG_SIZE - func_regvar_size;
+    ind = start;
+    if (frame) {
+        o(0xe5894855);  /* push %rbp, mov %rsp, %rbp */
+        for (i = 0; i < nb_regvars; i++)
+            orex(0, regvar_regs[i], 0, 0x50 + REG_VALUE(regvar_regs[i])); /* push */
+        v -= 8 * nb_regvars;
+        if (leaf && v <= RED_ZONE_SIZE)
+            ;
+        else if (v == (char)v) {
+            o(0xec8348); /* sub rsp, stacksize */
+            g(v);
+        } else {
+            o(0xec8148);
+            gen_le32(v);
+        }
+    }
+    /* move the prolog to the end of the room left for it and the entry
+       point of the function with it, unless it must stay aligned */
+    i = func_sub_sp_offset - ind;
+    if (i && !func_prolog_sym->a.aligned && !nooc_state->do_debug) {
+        memmove(cur_text_section->data + start + i,
+                cur_text_section->data + start, ind - start);
+        esym = elfsym(func_prolog_sym);
+        esym->st_value += i;
+        func_ind += i;
+        ind = start;
+    }
+    gen_fill_nops(i);
     ind = saved_ind;
 }
 
@@ -1653,7 +1928,10 @@ ST_FUNC void gen_fill_nops(int bytes)
 /* generate a jump to a label */
 int gjmp(int t)
 {
-    return gjmp2(0xe9, t);
+    peep_jmp = ind;
+    t = gjmp2(0xe9, t);
+    peep_jmp_end = ind;
+    return t;
 }
 
 /* generate a jump to a fixed address */
@@ -1696,19 +1974,64 @@ ST_FUNC int gjmp_cond(int op, int t)
 	       otherwise if unordered we don't want to jump.  */
             int v = vtop->cmp_r;
             op &= ~0x100;
+            /* peephole: a jump to the next instruction drops the 'jp +6'
+               over it too, while a 'jp t' stays in the chain of 't' */
+            peep_jmp = ind;
             if (op ^ v ^ (v != TOK_NE))
               o(0x067a);  /* jp +6 */
 	    else
 	      {
 	        g(0x0f);
 		t = gjmp2(0x8a, t); /* jp t */
+		peep_jmp = ind;
 	      }
 	  }
+        else
+          peep_jmp = ind;
         g(0x0f);
         t = gjmp2(op - 16, t);
+        peep_jmp_end = ind;
         return t;
 }
 
+/* r *= c: with lea for factors 3, 5 and 9 and shl for a power of 2, or
+   imul with an immediate */
+static void gen_mulc(int r, int c, int ll)
+{
+    static const unsigned char lea_f[3] = { 9, 5, 3 };
+    int f[2], n = 0, k = 0, i = 0, m = c;
+
+    if (m > 0 && REG_VALUE(r) != 5) {
+        for (; !(m & 1); m >>= 1)
+            ++k;
+        while (i < 3 && n < 2)
+            if (m % lea_f[i] == 0)
+                f[n++] = lea_f[i], m /= lea_f[i];
+            else
+                ++i;
+    }
+    if (m != 1) {
+        orex(ll, r, r, c == (char)c ? 0x6b : 0x69); /* imul $c, r, r */
+        o(0xc0 + REG_VALUE(r) * 9);
+        if (c == (char)c)
+            g(c);
+        else
+            gen_le32(c);
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        if (ll || REX_BASE(r))
+            o(0x40 | REX_BASE(r) * 7 | ll << 3);
+        o(0x048d | REG_VALUE(r) << 11); /* lea (r,r,f - 1), r */
+        g((f[i] == 3 ? 0x40 : f[i] == 5 ? 0x80 : 0xc0) | REG_VALUE(r) * 9);
+    }
+    if (k) {
+        orex(ll, r, 0, 0xc1); /* shl $k, r */
+        o(0xe0 | REG_VALUE(r));
+        g(k);
+    }
+}
+
 /* generate an integer binary operation */
 void gen_opi(int op)
 {
@@ -1730,7 +2053,10 @@ void gen_opi(int op)
             r = gv(RC_INT);
             vswap();
             c = vtop->c.i;
-            if (c == (char)c) {
+            if (c == 0 && opc == 7 && !nooc_state->no_peephole) {
+                orex(ll, r, r, 0x85); /* test r, r */
+                o(0xc0 + REG_VALUE(r) * 9);
+            } else if (c == (char)c) {
                 /* XXX: generate inc and dec for smaller code ? */
                 orex(ll, r, 0, 0x83);
                 o(0xc0 | (opc << 3) | REG_VALUE(r));
@@ -1770,6 +2096,14 @@ void gen_opi(int op)
         opc = 1;
         goto gen_op8;
     case '*':
+        if (cc && (!ll || (int)vtop->c.i == vtop->c.i)) {
+            vswap();
+            r = gv(RC_INT);
+            vswap();
+            gen_mulc(r, vtop->c.i, ll);
+            vtop--;
+            break;
+        }
         gv2(RC_INT, RC_INT);
         r = vtop[-1].r;
         fr = vtop[0].r;
@@ -1829,6 +2163,16 @@ void gen_opi(int op)
             r = TREG_RAX;
         vtop->r = r;
         break;
+    case TOK_UMULH:
+    case TOK_SMULH:
+        gv2(RC_RAX, RC_RCX);
+        fr = vtop[0].r;
+        vtop--;
+        save_reg(TREG_RDX);
+        orex(ll, fr, 0, 0xf7); /* mul/imul fr: %rdx:%rax = %rax * fr */
+        o((op == TOK_UMULH ? 0xe0 : 0xe8) + REG_VALUE(fr));
+        vtop->r = TREG_RDX;
+        break;
     default:
         opc = 7;
         goto gen_op8;
@@ -2074,6 +2418,7 @@ void gen_opf(int op)
 void gen_cvt_itof(int t)
 {
     if ((t & VT_BTYPE) == VT_LDOUBLE) {
+        func_leaf = 0; /* pushes */
         save_reg(TREG_ST0);
         gv(RC_INT);
         if ((vtop->type.t & VT_BTYPE) == VT_LLONG) {
@@ -2120,7 +2465,9 @@ void gen_cvt_ftof(int t)
     ft = vtop->type.t;
     bt = ft & VT_BTYPE;
     tbt = t & VT_BTYPE;
-    
+    if (bt == VT_LDOUBLE || tbt == VT_LDOUBLE)
+        func_leaf = 0; /* goes through -0x10(%rsp) */
+
     if (bt == VT_FLOAT) {
         gv(RC_FLOAT);
         if (tbt == VT_DOUBLE) {
@@ -2244,6 +2591,25 @@ ST_FUNC void ggoto(void)
     vtop--;
 }
 
+/* jump to tab[vtop], 0 <= vtop < n.  tab[] holds code addresses, or -1
+   for the code after the table.  The table follows the jump, as offsets
+   from its start. */
+ST_FUNC void gen_jmp_table(int *tab, int n)
+{
+    int r, t, i;
+
+    r = gv(RC_INT);
+    vtop--;
+    g(0x89), g(0xc0 + r * 9); /* mov %e(r),%e(r) */
+    o(0x1d8d4c), gen_le32(9); /* lea table(%rip),%r11 */
+    o(0x6349), g(0x04 + r * 8), g(0x83 + r * 8); /* movslq (%r11,%r,4),%r */
+    o(0x014c), g(0xd8 + r); /* add %r11,%r */
+    g(0xff), g(0xe0 + r); /* jmp *%r */
+    t = ind;
+    for (i = 0; i < n; i++)
+        gen_le32((tab[i] < 0 ? t + 4 * n : tab[i]) - t);
+}
+
 /* Save the stack pointer onto the stack and return the location of its address */
 ST_FUNC void gen_vla_sp_save(int addr) {
     /* mov %rsp,addr(%rbp)*/
@@ -2267,6 +2633,9 @@ ST_FUNC void gen_vla_result(int addr) {
 ST_FUNC void gen_vla_alloc(CType *type, int align) {
     int use_call = 0;
 
+    func_leaf = 0;
+    func_addr_taken = 1;
+
 #if defined(CONFIG_NOOC_BCHECK)
     use_call = nooc_state->do_bounds_check;
 #endif
@@ -2292,6 +2661,157 @@ ST_FUNC void gen_vla_alloc(CType *type, int align) {
     }
 }
 
+/* the largest memcpy (c < 0) or memset of the byte c which
+   gen_inline_mem() expands: 16 vector moves */
+ST_FUNC int inline_mem_max(int c)
+{
+    if (nooc_state->nosse)
+        return 15;
+    return (nooc_state->avx | nooc_state->avx2) && c <= 0 ? 512 : 256;
+}
+
+/* modrm byte and displacement of 'disp(base)' for the register 'r',
+   'base' is an integer register or VT_LOCAL for %rbp */
+static void gen_mem_modrm(int r, int base, int disp)
+{
+    if (base == VT_LOCAL) {
+        func_frame_used = 1;
+        base = 5; /* %rbp */
+    }
+    r = REG_VALUE(r) << 3 | REG_VALUE(base);
+    if (disp == (char)disp) {
+        o(0x40 | r);
+        g(disp);
+    } else {
+        oad(0x80 | r, disp);
+    }
+}
+
+/* movdqu, or vmovdqu with -mavx, of 'len' (16 or 32) bytes between
+   %xmm 'x' and 'disp(base)': 'op' is 0x6f to load and 0x7f to store */
+static void gen_vec_mov(int op, int x, int len, int base, int disp)
+{
+    int l = len == 32 ? 4 : 0;
+    if (nooc_state->avx | nooc_state->avx2) {
+        if (base != VT_LOCAL && REX_BASE(base))
+            g(0xc4), g(0xc1), g(0x7a | l); /* VEX.B */
+        else
+            g(0xc5), g(0xfa | l);
+        g(op);
+    } else {
+        g(0xf3);
+        orex(0, base, x, 0x0f);
+        g(op);
+    }
+    gen_mem_modrm(x, base, disp);
+}
+
+/* mov of 'n' bytes between the integer register 't' and 'disp(base)' */
+static void gen_int_mov(int store, int t, int n, int base, int disp)
+{
+    if (n == 1 && store) {
+        /* always a REX for %sil and %dil */
+        o(0x40 | (base != VT_LOCAL && REX_BASE(base)) | REX_BASE(t) << 2);
+        o(0x88);
+    } else if (n == 1) {
+        orex(0, base, t, 0xb60f); /* movzbl */
+    } else {
+        if (n == 2)
+            o(0x66);
+        orex(n == 8, base, t, store ? 0x89 : 0x8b);
+    }
+    gen_mem_modrm(t, base, disp);
+}
+
+/* the address on the stack is a local, addressed as 'disp(%rbp)' */
+static int is_local_addr(SValue *sv)
+{
+    return (sv->r & (VT_VALMASK | VT_LVAL | VT_SYM)) == VT_LOCAL;
+}
+
+/* copy 'size' bytes from 'src' to 'dest' (c < 0, the stack is 'dest
+   src') or set them to the byte c (the stack is 'dest') with unrolled
+   vector moves, and a few integer moves below 16 bytes.  The tail of a
+   longer block is moved by a vector overlapping the previous one. */
+ST_FUNC void gen_inline_mem(int c, int size)
+{
+    int n = c < 0, d, s = 0, dd, sd = 0, x = 0, t = 0, i, len, avx;
+
+    /* addresses */
+    if (!is_local_addr(vtop - n)) {
+        if (n && !is_local_addr(vtop)) {
+            gv2(RC_INT, RC_INT);
+        } else {
+            if (n)
+                vswap();
+            gv(RC_INT);
+            if (n)
+                vswap();
+        }
+    } else if (n && !is_local_addr(vtop)) {
+        gv(RC_INT);
+    }
+    d = vtop[-n].r & VT_VALMASK;
+    dd = d == VT_LOCAL ? vtop[-n].c.i : 0;
+    if (n) {
+        s = vtop->r & VT_VALMASK;
+        sd = s == VT_LOCAL ? vtop->c.i : 0;
+    }
+
+    avx = (nooc_state->avx | nooc_state->avx2) && c <= 0;
+    if (size < 16 || c > 0) {
+        t = get_reg(RC_INT);
+        if (c == 0) {
+            orex(0, t, t, 0x31); /* xor %t, %t */
+            o(0xc0 | REG_VALUE(t) * 9);
+        } else if (c > 0) {
+            orex(1, t, 0, 0xb8 + REG_VALUE(t)); /* movabs */
+            gen_le64(0x0101010101010101ULL * c);
+        }
+    }
+    if (size >= 16) {
+        x = get_reg(RC_FLOAT);
+        if (c == 0 && avx) {
+            /* vxorps %ymm, %ymm, %ymm */
+            g(0xc5), g(0xfc - (REG_VALUE(x) << 3)), g(0x57);
+            g(0xc0 | REG_VALUE(x) * 9);
+        } else if (c == 0) {
+            o(0xef0f66); /* pxor %xmm, %xmm */
+            o(0xc0 | REG_VALUE(x) * 9);
+        } else if (c > 0) {
+            o(0x66);
+            orex(1, t, 0, 0x6e0f); /* movq %t, %xmm */
+            o(0xc0 | REG_VALUE(x) << 3 | REG_VALUE(t));
+            o(0x6c0f66); /* punpcklqdq %xmm, %xmm */
+            o(0xc0 | REG_VALUE(x) * 9);
+        }
+    }
+
+    for (i = 0; i < size; i += len) {
+        len = size - i;
+        if (len >= 16) {
+            len = len >= 32 && avx ? 32 : 16;
+        } else if (size >= 16) {
+            /* overlap the previous vector */
+            i = size - 16, len = 16;
+        } else {
+            len = len >= 8 ? 8 : len >= 4 ? 4 : len >= 2 ? 2 : 1;
+            if (n)
+                gen_int_mov(0, t, len, s, sd + i);
+            gen_int_mov(1, t, len, d, dd + i);
+            continue;
+        }
+        if (n)
+            gen_vec_mov(0x6f, x, len, s, sd + i);
+        gen_vec_mov(0x7f, x, len, d, dd + i);
+    }
+    if (avx && size >= 16)
+        o(0x77f8c5); /* vzeroupper */
+    if (n)
+        vpop();
+    vpop();
+}
+
 /*
  * Assmuing the top part of the stack looks like below,
  *  src dest src
@@ -2299,6 +2819,11 @@ ST_FUNC void gen_vla_alloc(CType *type, int align) {
 ST_FUNC void gen_struct_copy(int size)
 {
     int n = size / PTR_SIZE;
+
+    if (size <= inline_mem_max(-1)) {
+        gen_inline_mem(-1, size);
+        return;
+    }
 #ifdef NOOC_TARGET_PE
     o(0x5756); /* push rsi, rdi */
 #endif
@@ -2325,6 +2850,262 @@ ST_FUNC void gen_struct_copy(int size)
     vpop();
 }
 
+#ifdef NOOC_TARGET_VECTORIZE
+/* SSE2 instructions, VEX encoded with -mavx2 and then on 32 bytes
+   if V_Y is set: the opcode byte, its prefix and map, and the
+   immediate byte of a compare plus 1 */
+#define V_66   0x100
+#define V_F3   0x200
+#define V_F2   0x300
+#define V_0F38 0x400
+#define V_0F3A 0x800
+#define V_W    0x1000
+#define V_Y    0x2000
+#define V_AVX2 0x4000 /* needs -mavx2 */
+#define V_IMM(i) (((i) + 1) << 16)
+
+/* by lane: char, short, int, long long, float, double */
+static const int vec_ops[VEC_NB_OPS][6] = {
+    /* VEC_ADD: padd, addps, addpd */
+    { V_66|0xfc, V_66|0xfd, V_66|0xfe, V_66|0xd4, 0x58, V_66|0x58 },
+    /* VEC_SUB: psub, subps, subpd */
+    { V_66|0xf8, V_66|0xf9, V_66|0xfa, V_66|0xfb, 0x5c, V_66|0x5c },
+    /* VEC_MUL: pmullw, vpmulld, mulps, mulpd */
+    { 0, V_66|0xd5, V_AVX2|V_66|V_0F38|0x40, 0, 0x59, V_66|0x59 },
+    /* VEC_AND, VEC_OR, VEC_XOR, VEC_ANDN, VEC_MOV: pand, por, pxor,
+       pandn, movdqa */
+    { V_66|0xdb, V_66|0xdb, V_66|0xdb, V_66|0xdb, V_66|0xdb, V_66|0xdb },
+    { V_66|0xeb, V_66|0xeb, V_66|0xeb, V_66|0xeb, V_66|0xeb, V_66|0xeb },
+    { V_66|0xef, V_66|0xef, V_66|0xef, V_66|0xef, V_66|0xef, V_66|0xef },
+    { V_66|0xdf, V_66|0xdf, V_66|0xdf, V_66|0xdf, V_66|0xdf, V_66|0xdf },
+    { V_66|0x6f, V_66|0x6f, V_66|0x6f, V_66|0x6f, V_66|0x6f, V_66|0x6f },
+    /* VEC_CMPEQ: pcmpeq, vpcmpeqq, cmpeqps, cmpeqpd */
+    { V_66|0x74, V_66|0x75, V_66|0x76, V_AVX2|V_66|V_0F38|0x29,
+      V_IMM(0)|0xc2, V_IMM(0)|V_66|0xc2 },
+    /* VEC_CMPNE, VEC_CMPLT, VEC_CMPLE: cmpps, cmppd */
+    { 0, 0, 0, 0, V_IMM(4)|0xc2, V_IMM(4)|V_66|0xc2 },
+    { 0, 0, 0, 0, V_IMM(1)|0xc2, V_IMM(1)|V_66|0xc2 },
+    { 0, 0, 0, 0, V_IMM(2)|0xc2, V_IMM(2)|V_66|0xc2 },
+    /* VEC_CMPGT: pcmpgt, vpcmpgtq */
+    { V_66|0x64, V_66|0x65, V_66|0x66, V_AVX2|V_66|V_0F38|0x37, 0, 0 },
+};
+
+static int vec_lane(int t)
+{
+    switch (t & VT_BTYPE) {
+    case VT_BYTE: return 0;
+    case VT_SHORT: return 1;
+    case VT_INT: return 2;
+    case VT_LLONG: return 3;
+    case VT_FLOAT: return 4;
+    default: return 5;
+    }
+}
+
+/* emit 'op' with the register 'r' in the reg field, the second source
+   'v' of the VEX form (0 if none) and the register 'b', or the memory
+   operand 'b + x * scale' if x >= 0 */
+static void vec_insn(int op, int r, int v, int b, int x, int scale)
+{
+    int pp = op >> 8 & 3, map = op & V_0F38 ? 2 : op & V_0F3A ? 3 : 1;
+    int w = !!(op & V_W), l = op & V_Y && nooc_state->avx2;
+    int rr = REX_BASE(r), rx = x >= 0 && REX_BASE(x), rb = REX_BASE(b);
+
+    if (nooc_state->avx2) {
+        if (map == 1 && !w && !rx && !rb) {
+            g(0xc5);
+            g(!rr << 7 | (~v & 15) << 3 | l << 2 | pp);
+        } else {
+            g(0xc4);
+            g(!rr << 7 | !rx << 6 | !rb << 5 | map);
+            g(w << 7 | (~v & 15) << 3 | l << 2 | pp);
+        }
+    } else {
+        if (pp)
+            g(pp == 1 ? 0x66 : pp == 2 ? 0xf3 : 0xf2);
+        if (w || rr || rx || rb)
+            g(0x40 | w << 3 | rr << 2 | rx << 1 | rb);
+        g(0x0f);
+        if (map > 1)
+            g(map == 2 ? 0x38 : 0x3a);
+    }
+    g(op);
+    if (x < 0) {
+        g(0xc0 | REG_VALUE(r) << 3 | REG_VALUE(b));
+    } else {
+        /* (%rbp, %r13) only with a displacement */
+        int mod = REG_VALUE(b) == 5 ? 0x40 : 0;
+        g(mod | REG_VALUE(r) << 3 | 4);
+        g((scale == 8 ? 3 : scale == 4 ? 2 : scale == 2) << 6
+          | REG_VALUE(x) << 3 | REG_VALUE(b));
+        if (mod)
+            g(0);
+    }
+}
+
+/* bytes per vector */
+ST_FUNC int gen_vec_size(void)
+{
+    return nooc_state->avx2 ? 32 : 16;
+}
+
+/* can the operation 'op' be done on lanes of the type 't' */
+ST_FUNC int gen_vec_ok(int op, int t)
+{
+    int c = vec_ops[op][vec_lane(t)];
+    return c && !nooc_state->nosse && (!(c & V_AVX2) || nooc_state->avx2);
+}
+
+/* d = d op s */
+ST_FUNC void gen_vec_op(int op, int t, int d, int s)
+{
+    int c = vec_ops[op][vec_lane(t)];
+
+    vec_insn(c | V_Y, d, op == VEC_MOV ? 0 : d, s, -1, 0);
+    if (c >> 16)
+        g((c >> 16) - 1);
+}
+
+/* movdqu between x and 'base + index * size' */
+ST_FUNC void gen_vec_mem(int store, int x, int base, int index, int size)
+{
+    vec_insn(V_F3 | V_Y | (store ? 0x7f : 0x6f), x, 0, base, index, size);
+}
+
+/* fill every lane of x with vtop, of the type 't' */
+ST_FUNC void gen_vec_splat(int x, int t)
+{
+    int lane = vec_lane(t), r;
+
+    if (lane >= 4) {
+        r = gv(RC_FLOAT) - TREG_XMM0;
+        vec_insn(V_66|0x70, x, 0, r, -1, 0); /* pshufd */
+        g(lane == 4 ? 0 : 0x44);
+    } else {
+        r = gv(RC_INT);
+        vec_insn(V_66|0x6e | (lane == 3 ? V_W : 0), x, 0, r, -1, 0); /* movd */
+        if (lane == 0)
+            vec_insn(V_66|0x60, x, x, x, -1, 0); /* punpcklbw */
+        if (lane <= 1) {
+            vec_insn(V_F2|0x70, x, 0, x, -1, 0); /* pshuflw */
+            g(0);
+        }
+        vec_insn(V_66|0x70, x, 0, x, -1, 0); /* pshufd */
+        g(lane == 3 ? 0x44 : 0);
+    }
+    if (nooc_state->avx2) {
+        vec_insn(V_66|V_0F3A|V_Y|0x38, x, x, x, -1, 0); /* vinserti128 */
+        g(1);
+    }
+    vpop();
+}
+
+/* push the sum of the int or long long lanes of x, using tmp */
+ST_FUNC void gen_vec_reduce(int x, int tmp, int t)
+{
+    int add = vec_ops[VEC_ADD][vec_lane(t)], r;
+    CType type;
+
+    if (nooc_state->avx2) {
+        vec_insn(V_66|V_0F3A|V_Y|0x39, x, 0, tmp, -1, 0); /* vextracti128 */
+        g(1);
+        vec_insn(add, x, x, tmp, -1, 0);
+    }
+    vec_insn(V_66|0x70, tmp, 0, x, -1, 0); /* pshufd */
+    g(0x4e);
+    vec_insn(add, x, x, tmp, -1, 0);
+    if (vec_lane(t) == 2) {
+        vec_insn(V_66|0x70, tmp, 0, x, -1, 0);
+        g(0xb1);
+        vec_insn(add, x, x, tmp, -1, 0);
+    }
+    r = get_reg(RC_INT);
+    vec_insn(V_66|0x7e | (vec_lane(t) == 3 ? V_W : 0), x, 0, r, -1, 0); /* movd */
+    type.t = t;
+    type.ref = NULL;
+    vset(&type, r, 0);
+}
+
+/* jump to 't' if a lane of the mask x is set */
+ST_FUNC int gen_vec_any(int x, int t)
+{
+    int r = get_reg(RC_INT);
+
+    vec_insn(V_66|V_Y|0xd7, r, 0, x, -1, 0); /* pmovmskb */
+    orex(0, r, r, 0x85); /* test */
+    o(0xc0 + REG_VALUE(r) * 9);
+    return gjmp_cond(TOK_NE, t);
+}
+
+/* jump to 't' if the addresses d and s are less than a vector apart
+   with s below d: a store to d would change what is loaded from s
+   later in the same vector */
+ST_FUNC int gen_vec_overlap(int d, int s, int t)
+{
+    int r = get_reg(RC_INT);
+
+    orex(1, r, d, 0x89); /* mov d, r */
+    o(0xc0 + REG_VALUE(r) + REG_VALUE(d) * 8);
+    orex(1, r, s, 0x29); /* sub s, r */
+    o(0xc0 + REG_VALUE(r) + REG_VALUE(s) * 8);
+    orex(1, r, 0, 0x83); /* sub $1, r */
+    o(0xe8 + REG_VALUE(r));
+    g(1);
+    orex(1, r, 0, 0x83); /* cmp $size-1, r */
+    o(0xf8 + REG_VALUE(r));
+    g(gen_vec_size() - 1);
+    return gjmp_cond(TOK_ULT, t);
+}
+
+/* jump to 't' if the vector at 'base + index * size' is not within a
+   page: loads past the end of the data must not fault */
+ST_FUNC int gen_vec_page(int base, int index, int size, int t)
+{
+    int r = get_reg(RC_INT);
+
+    /* lea (base, index, size), r */
+    g(0x48 | REX_BASE(r) << 2 | REX_BASE(index) << 1 | REX_BASE(base));
+    g(0x8d);
+    g((REG_VALUE(base) == 5 ? 0x40 : 0) | REG_VALUE(r) << 3 | 4);
+    g((size == 8 ? 3 : size == 4 ? 2 : size == 2) << 6
+      | REG_VALUE(index) << 3 | REG_VALUE(base));
+    if (REG_VALUE(base) == 5)
+        g(0);
+    orex(1, r, 0, 0x81); /* and $4095, r */
+    o(0xe0 + REG_VALUE(r));
+    gen_le32(4095);
+    orex(1, r, 0, 0x81); /* cmp $4096-size, r */
+    o(0xf8 + REG_VALUE(r));
+    gen_le32(4096 - gen_vec_size());
+    return gjmp_cond(TOK_UGT, t);
+}
+
+/* ri += step, then jump to 't' if 'ri + n' compared to rn satisfies
+   'op' */
+ST_FUNC int gen_vec_jmp(int ri, int rn, int step, int n, int op, int t)
+{
+    int r = get_reg(RC_INT);
+
+    if (step) {
+        orex(1, ri, 0, 0x83); /* add $step, ri */
+        o(0xc0 + REG_VALUE(ri));
+        g(step);
+    }
+    orex(1, ri, r, 0x8d); /* lea n(ri), r */
+    o(0x40 + REG_VALUE(r) * 8 + REG_VALUE(ri));
+    g(n);
+    orex(1, r, rn, 0x39); /* cmp rn, r */
+    o(0xc0 + REG_VALUE(r) + REG_VALUE(rn) * 8);
+    return gjmp_cond(op, t);
+}
+
+ST_FUNC void gen_vec_end(void)
+{
+    if (nooc_state->avx2)
+        o(0x77f8c5); /* vzeroupper */
+}
+#endif
+
 /* end of x86-64 code generator */
 /*************************************************************/
 #endif /* ! TARGET_DEFS_ONLY */
@@ -17,6 +17,7 @@
 
 #define PCRELATIVE_DLLPLT 1
 #define RELOCATE_DLLPLT 1
+#define RELOCATE_PARALLEL 1
 
 #else /* !TARGET_DEFS_ONLY */
 